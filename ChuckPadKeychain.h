@@ -16,6 +16,9 @@
 
 - (void)authSucceededWithUser:(User *)user;
 
+// Credentials are stored per environment. Call after switching environments so they are read again.
+- (void)environmentChanged;
+
 - (NSInteger)getLoggedInUserId;
 
 - (NSString *)getLoggedInUserName;
@@ -4,11 +4,34 @@
 
 #import "ChuckPadKeychain.h"
 
+#import <Security/Security.h>
+
 #import "FXKeychain.h"
 #import "ChuckPadSocial.h"
 #import "User.h"
 
-@implementation ChuckPadKeychain
+// Keys into the credentials record (and the in-memory snapshot of it)
+static NSString *const RECORD_VERSION = @"version";
+static NSString *const RECORD_USER_ID = @"userId";
+static NSString *const RECORD_USERNAME = @"username";
+static NSString *const RECORD_EMAIL = @"email";
+static NSString *const RECORD_AUTH_TOKEN = @"authToken";
+
+// Bump when the layout of the credentials record changes. Records with a version we do not know are ignored.
+static const NSInteger CREDENTIALS_RECORD_VERSION = 1;
+
+// Credentials are stored as a single versioned record (one Keychain item) so logging in or out is one Keychain write
+// and can never leave a half-written set of credentials behind. Older versions of this library stored each field as
+// its own item; those are migrated to the record the first time credentials are read.
+//
+// Every API call checks whether someone is logged in and reads their user id and auth token. Credentials only change
+// through this class (or when the environment, which is part of every keychain key, changes) so the record is read
+// from the Keychain once and served from an in-memory snapshot after that. A read that fails (e.g. because the device
+// is locked while a background task runs) is not cached so the next call reads again.
+@implementation ChuckPadKeychain {
+    @private NSDictionary *credentialSnapshot;
+    @private BOOL legacyCredentialsRemain;
+}
 
 + (ChuckPadKeychain *)sharedInstance {
     static ChuckPadKeychain *_instance = nil;
@@ -25,44 +48,173 @@
 }
 
 - (void)clearCredentials {
-    [[self keychain] setObject:nil forKey:[self getUserIdKey]];
-    [[self keychain] setObject:nil forKey:[self getUsernameKey]];
-    [[self keychain] setObject:nil forKey:[self getEmailKey]];
-    [[self keychain] setObject:nil forKey:[self getAuthTokenKey]];
+    @synchronized (self) {
+        // Make sure any legacy items have been migrated (and so deleted) before removing the record
+        [self credentialSnapshot];
+        if (legacyCredentialsRemain) {
+            [self removeLegacyCredentials];
+        }
+
+        [[self keychain] setObject:nil forKey:[self getCredentialsRecordKey]];
+        credentialSnapshot = @{};
+    }
 }
 
 - (void)authSucceededWithUser:(User *)user {
-    [[self keychain] setObject:@(user.userId) forKey:[self getUserIdKey]];
-    [[self keychain] setObject:user.username forKey:[self getUsernameKey]];
-    [[self keychain] setObject:user.email forKey:[self getEmailKey]];
-    [[self keychain] setObject:user.authToken forKey:[self getAuthTokenKey]];
+    NSMutableDictionary *record = [[NSMutableDictionary alloc] init];
+    record[RECORD_USER_ID] = @(user.userId);
+    record[RECORD_USERNAME] = user.username;
+    record[RECORD_EMAIL] = user.email;
+    record[RECORD_AUTH_TOKEN] = user.authToken;
+
+    @synchronized (self) {
+        // Migrate first so leftover legacy items from an earlier user cannot resurface later
+        [self credentialSnapshot];
+        [self writeCredentialsRecord:record];
+    }
+}
+
+- (void)environmentChanged {
+    @synchronized (self) {
+        // Legacy items are stored per environment too, so a cleanup still pending belongs to the old one
+        credentialSnapshot = nil;
+        legacyCredentialsRemain = NO;
+    }
 }
 
 - (NSInteger)getLoggedInUserId {
-    return [[[self keychain] objectForKey:[self getUserIdKey]] integerValue];
+    return [[self credentialSnapshot][RECORD_USER_ID] integerValue];
 }
 
 - (NSString *)getLoggedInUserName {
-    return [[self keychain] objectForKey:[self getUsernameKey]];
+    return [self credentialSnapshot][RECORD_USERNAME];
 }
 
 - (NSString *)getLoggedInEmail {
-    return [[self keychain] objectForKey:[self getEmailKey]];
+    return [self credentialSnapshot][RECORD_EMAIL];
 }
 
 - (NSString *)getLoggedInAuthToken {
-    return [[self keychain] objectForKey:[self getAuthTokenKey]];
+    return [self credentialSnapshot][RECORD_AUTH_TOKEN];
 }
 
 - (BOOL)isLoggedIn {
-    for (NSString *key in @[[self getUserIdKey], [self getUsernameKey], [self getEmailKey], [self getAuthTokenKey]]) {
-        if ([[self keychain] objectForKey:key] == nil) {
+    NSDictionary *snapshot = [self credentialSnapshot];
+    for (NSString *key in @[RECORD_USER_ID, RECORD_USERNAME, RECORD_EMAIL, RECORD_AUTH_TOKEN]) {
+        if (snapshot[key] == nil) {
             return NO;
         }
     }
     return YES;
 }
 
+- (NSDictionary *)credentialSnapshot {
+    @synchronized (self) {
+        if (credentialSnapshot == nil) {
+            credentialSnapshot = [self readCredentialsRecord];
+        }
+        return credentialSnapshot;
+    }
+}
+
+#pragma mark - Credentials Record
+
+// Returns nil if the Keychain could not be read, as opposed to an empty dictionary when it holds no credentials.
+- (NSDictionary *)readCredentialsRecord {
+    id record = [[self keychain] objectForKey:[self getCredentialsRecordKey]];
+    if ([record isKindOfClass:[NSDictionary class]]) {
+        if ([record[RECORD_VERSION] integerValue] != CREDENTIALS_RECORD_VERSION) {
+            NSLog(@"readCredentialsRecord - ignoring credentials record with unknown version %@", record[RECORD_VERSION]);
+            return @{};
+        }
+        return record;
+    }
+
+    if (record == nil && ![self keychainHasNoItemForKey:[self getCredentialsRecordKey]]) {
+        NSLog(@"readCredentialsRecord - could not read the Keychain");
+        return nil;
+    }
+
+    return [self migrateLegacyCredentials];
+}
+
+// FXKeychain returns nil both when there is no item and when the Keychain could not be read (errSecInteractionNotAllowed
+// while the device is locked, for example), so ask the Keychain directly which one it was.
+- (BOOL)keychainHasNoItemForKey:(NSString *)key {
+    NSMutableDictionary *query = [[NSMutableDictionary alloc] init];
+    if ([[self keychain].service length] > 0) {
+        query[(__bridge NSString *)kSecAttrService] = [self keychain].service;
+    }
+    query[(__bridge NSString *)kSecClass] = (__bridge id)kSecClassGenericPassword;
+    query[(__bridge NSString *)kSecAttrAccount] = key;
+    query[(__bridge NSString *)kSecMatchLimit] = (__bridge id)kSecMatchLimitOne;
+    return SecItemCopyMatching((__bridge CFDictionaryRef)query, NULL) == errSecItemNotFound;
+}
+
+// Stores record with the current version and makes it the snapshot. The snapshot is only updated if the write worked
+// so it always matches what the Keychain holds.
+- (void)writeCredentialsRecord:(NSDictionary *)record {
+    NSMutableDictionary *versionedRecord = [record mutableCopy];
+    versionedRecord[RECORD_VERSION] = @(CREDENTIALS_RECORD_VERSION);
+
+    if ([[self keychain] setObject:versionedRecord forKey:[self getCredentialsRecordKey]]) {
+        credentialSnapshot = versionedRecord;
+    } else {
+        NSLog(@"writeCredentialsRecord - failed to store credentials");
+        credentialSnapshot = nil;
+    }
+}
+
+// Reads credentials stored one item per field, writes them as a record and deletes the old items. The old items are
+// left alone if the record could not be written so nothing is lost. Returns nil if any of them could not be read.
+- (NSDictionary *)migrateLegacyCredentials {
+    NSArray *legacyKeys = @[[self getUserIdKey], [self getUsernameKey], [self getEmailKey], [self getAuthTokenKey]];
+    NSArray *recordKeys = @[RECORD_USER_ID, RECORD_USERNAME, RECORD_EMAIL, RECORD_AUTH_TOKEN];
+
+    NSMutableDictionary *record = [[NSMutableDictionary alloc] init];
+    for (NSUInteger i = 0; i < [legacyKeys count]; i++) {
+        id value = [[self keychain] objectForKey:legacyKeys[i]];
+        if (value == nil && ![self keychainHasNoItemForKey:legacyKeys[i]]) {
+            NSLog(@"migrateLegacyCredentials - could not read the Keychain");
+            return nil;
+        }
+        record[recordKeys[i]] = value;
+    }
+
+    if ([record count] == 0) {
+        return @{};
+    }
+
+    NSLog(@"migrateLegacyCredentials - migrating %lu legacy credential items", (unsigned long)[record count]);
+
+    // Legacy user ids were stored as numbers but may come back as strings depending on how they were encoded
+    if (record[RECORD_USER_ID] != nil) {
+        record[RECORD_USER_ID] = @([record[RECORD_USER_ID] integerValue]);
+    }
+
+    [self writeCredentialsRecord:record];
+    if (credentialSnapshot == nil) {
+        legacyCredentialsRemain = YES;
+        return record;
+    }
+
+    [self removeLegacyCredentials];
+    return credentialSnapshot;
+}
+
+- (void)removeLegacyCredentials {
+    for (NSString *legacyKey in @[[self getUserIdKey], [self getUsernameKey], [self getEmailKey], [self getAuthTokenKey]]) {
+        [[self keychain] setObject:nil forKey:legacyKey];
+    }
+    legacyCredentialsRemain = NO;
+}
+
+- (NSString *)getCredentialsRecordKey {
+    return [self getKeyForString:@"credentials"];
+}
+
+// Legacy per-field keys; only used for migration
+
 - (NSString *)getUserIdKey {
     return [self getKeyForString:@"userId"];
 }
@@ -0,0 +1,27 @@
+//
+//  ChuckPadResponseSerializer.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  The service wraps most replies in a { "code": ..., "message": ... } envelope where "message" is itself a JSON
+//  document encoded as a string. This serializer decodes the envelope and, when "message" holds JSON, the payload in
+//  the same pass on AFNetworking's processing queue so the model mappers in ChuckPadSocial receive ready-to-use
+//  dictionaries and arrays. Plain string messages (e.g. error text) are left as strings.
+//
+//  Requests sent with CHUCKPAD_ACCEPT_HEADER_VALUE ask for MessagePack, which is smaller than JSON and decodes straight
+//  into the dictionaries the mappers expect without the string-in-JSON envelope. Responses are decoded by their
+//  Content-Type so a service that only speaks JSON keeps working unchanged.
+
+#import "AFURLResponseSerialization.h"
+
+// Accept header value for requests whose responses go through this serializer
+extern NSString *const CHUCKPAD_ACCEPT_HEADER_VALUE;
+
+@interface ChuckPadResponseSerializer : AFJSONResponseSerializer
+
+// Decodes a JSON document stored in a string. The string's bytes are used in place when it stores them as UTF-8
+// compatible bytes, otherwise it is converted to UTF-8 once. Returns nil if the string does not hold a JSON array or
+// object.
++ (id)JSONObjectFromMessageString:(NSString *)message;
+
+@end
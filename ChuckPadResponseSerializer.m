@@ -0,0 +1,115 @@
+//
+//  ChuckPadResponseSerializer.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+
+#import "ChuckPadResponseSerializer.h"
+#import "MessagePackDecoder.h"
+
+static NSString *const ENVELOPE_MESSAGE_KEY = @"message";
+
+// There is no single registered MessagePack MIME type so accept the ones in common use
+static NSString *const MESSAGE_PACK_CONTENT_TYPE = @"application/x-msgpack";
+static NSString *const MESSAGE_PACK_ALTERNATE_CONTENT_TYPE = @"application/msgpack";
+static NSString *const MESSAGE_PACK_VND_CONTENT_TYPE = @"application/vnd.msgpack";
+
+// MessagePack first; a service that does not know it picks JSON
+NSString *const CHUCKPAD_ACCEPT_HEADER_VALUE = @"application/x-msgpack, application/json;q=0.9";
+
+@implementation ChuckPadResponseSerializer
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        self.acceptableContentTypes = [self.acceptableContentTypes setByAddingObjectsFromArray:@[MESSAGE_PACK_CONTENT_TYPE,
+                                                                                                 MESSAGE_PACK_ALTERNATE_CONTENT_TYPE,
+                                                                                                 MESSAGE_PACK_VND_CONTENT_TYPE]];
+    }
+    return self;
+}
+
+- (id)responseObjectForResponse:(NSURLResponse *)response data:(NSData *)data error:(NSError *__autoreleasing *)error {
+    id responseObject;
+    if ([ChuckPadResponseSerializer isMessagePackResponse:response]) {
+        responseObject = [self messagePackObjectForResponse:response data:data error:error];
+    } else {
+        responseObject = [super responseObjectForResponse:response data:data error:error];
+    }
+
+    if (![responseObject isKindOfClass:[NSDictionary class]]) {
+        return responseObject;
+    }
+
+    // A MessagePack envelope normally carries "message" as a map or array already, which is left as is below
+    id message = responseObject[ENVELOPE_MESSAGE_KEY];
+    if (![message isKindOfClass:[NSString class]]) {
+        return responseObject;
+    }
+
+    id decodedMessage = [ChuckPadResponseSerializer JSONObjectFromMessageString:message];
+    if (decodedMessage == nil) {
+        return responseObject;
+    }
+
+    NSMutableDictionary *envelope = [responseObject mutableCopy];
+    envelope[ENVELOPE_MESSAGE_KEY] = decodedMessage;
+    return envelope;
+}
+
+// Mirrors AFJSONResponseSerializer: a response with an unacceptable status code still has its body decoded since error
+// bodies carry the service's error message. The content type check in validateResponse always passes here.
+- (id)messagePackObjectForResponse:(NSURLResponse *)response data:(NSData *)data error:(NSError *__autoreleasing *)error {
+    NSError *validationError = nil;
+    [self validateResponse:(NSHTTPURLResponse *)response data:data error:&validationError];
+    if (error != NULL) {
+        *error = validationError;
+    }
+
+    if (data.length == 0) {
+        return nil;
+    }
+
+    NSError *decodingError = nil;
+    id responseObject = [MessagePackDecoder objectWithData:data error:&decodingError];
+    if (responseObject == nil && validationError == nil && error != NULL) {
+        *error = decodingError;
+    }
+    return responseObject;
+}
+
++ (BOOL)isMessagePackResponse:(NSURLResponse *)response {
+    NSString *MIMEType = [response.MIMEType lowercaseString];
+    return [MIMEType isEqualToString:MESSAGE_PACK_CONTENT_TYPE] ||
+           [MIMEType isEqualToString:MESSAGE_PACK_ALTERNATE_CONTENT_TYPE] ||
+           [MIMEType isEqualToString:MESSAGE_PACK_VND_CONTENT_TYPE];
+}
+
++ (id)JSONObjectFromMessageString:(NSString *)message {
+    // Cheap check on the first character so plain text messages are never handed to NSJSONSerialization
+    NSUInteger length = [message length];
+    NSUInteger start = 0;
+    while (start < length && [[NSCharacterSet whitespaceAndNewlineCharacterSet] characterIsMember:[message characterAtIndex:start]]) {
+        start++;
+    }
+
+    if (start == length || ([message characterAtIndex:start] != '[' && [message characterAtIndex:start] != '{')) {
+        return nil;
+    }
+
+    // CFStringGetCStringPtr returns the string's own storage when it can, which for a message that is plain ASCII is
+    // the common case, so wrapping it avoids any copy. Otherwise UTF8String makes one UTF-8 copy, which NSData then
+    // wraps without copying again.
+    const char *utf8 = CFStringGetCStringPtr((__bridge CFStringRef)message, kCFStringEncodingUTF8);
+    if (utf8 == NULL) {
+        utf8 = [message UTF8String];
+    }
+    if (utf8 == NULL) {
+        return nil;
+    }
+
+    NSData *data = [NSData dataWithBytesNoCopy:(void *)utf8 length:strlen(utf8) freeWhenDone:NO];
+    return [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+}
+
+@end
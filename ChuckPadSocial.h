@@ -13,6 +13,7 @@
 #import "LiveSession.h"
 #import "Patch.h"
 #import "PatchCache.h"
+#import "PatchDiskCache.h"
 #import "PatchResource.h"
 #import "User.h"
 
@@ -22,6 +23,14 @@
 // user has 0), the callback will return an NSArry of size 0 and a nil error.
 typedef void(^GetPatchesCallback)(NSArray *patchesArray, NSError *error);
 
+// Paged variant of the above. Pass nextCursor as the after parameter of the same call to fetch the following page.
+// nextCursor is nil once the last page has been returned.
+typedef void(^GetPatchesPageCallback)(NSArray *patchesArray, NSString *nextCursor, NSError *error);
+
+// Delivers a patch list in batches while it is still downloading. Called zero or more times with finished = NO as
+// batches are parsed, then exactly once with finished = YES carrying any remaining patches or an error.
+typedef void(^GetPatchesProgressiveCallback)(NSArray *patchesBatch, BOOL finished, NSError *error);
+
 typedef void(^CreateUserCallback)(BOOL succeeded, NSError *error);
 
 typedef void(^CreatePatchCallback)(BOOL succeeded, Patch *patch, NSError *error);
@@ -30,10 +39,17 @@ typedef void(^UpdatePatchCallback)(BOOL succeeded, Patch *patch, NSError *error)
 
 typedef void(^GetPatchInfoCallback)(BOOL succeeded, Patch *patch, NSError *error);
 
+// Maps each requested GUID to its Patch. GUIDs the service does not know about are left out.
+typedef void(^GetPatchInfoBatchCallback)(BOOL succeeded, NSDictionary<NSString *, Patch *> *guidToPatchDictionary, NSError *error);
+
 typedef void(^DeletePatchCallback)(BOOL succeeded, NSError *error);
 
 typedef void(^DownloadResourceCallback)(NSData *resourceData, NSError *error);
 
+// Called on the callback queue (see setCallbackQueue) as a download progresses. totalBytes is NSURLResponseUnknownLength (-1) if the service did not
+// say how big the resource is. A resumed download starts reporting from the bytes it already had.
+typedef void(^DownloadProgressCallback)(int64_t bytesReceived, int64_t totalBytes);
+
 typedef void(^ReportAbuseCallback)(BOOL succeeded, NSError *error);
 
 typedef void(^LogOutCallback)(BOOL succeeded, NSError *error);
@@ -85,9 +101,28 @@ typedef enum {
 // called before any other method on ChuckPadSocial!
 + (void)bootstrapForPatchType:(PatchType)patchType;
 
+// Optional. Tunes the HTTP sessions used for API calls and resource downloads: the maximum number of simultaneous
+// connections to the service, the request timeout in seconds, and the NSURLCache policy for resource downloads. To
+// take effect this must be called before the first call to sharedInstance.
++ (void)configureNetworkWithMaxConnectionsPerHost:(NSInteger)maxConnectionsPerHost timeout:(NSTimeInterval)timeout
+                              downloadCachePolicy:(NSURLRequestCachePolicy)downloadCachePolicy;
+
 // Returns the ChuckPadSocial singleton instance.
 + (ChuckPadSocial *)sharedInstance;
 
+#pragma mark - Callback Queue
+
+// Sets the queue all callbacks are delivered on. Defaults to the main queue; passing nil restores the default.
+// Responses are mapped to model objects on a background queue before being handed over so this queue only runs the
+// callback itself. It should be a serial queue so progress callbacks and the batches of progressive fetches arrive in
+// order. Calls answered without going to the network (e.g. from PatchCache, or rejected because no user is logged in)
+// also call back on this queue, never before the call returns. Safe to call at any time; calls already completing may
+// still call back on the previous queue.
+//
+// Breaking change: calls answered from PatchCache or rejected up front used to call back before returning, on the
+// calling thread. Callers that relied on that must now wait for the callback.
+- (void)setCallbackQueue:(dispatch_queue_t)queue;
+
 #pragma mark - Environment
 
 // Returns the root URL of the environment API calls will be made against.
@@ -148,6 +183,10 @@ typedef enum {
 // Gets patch metadata for the given patch GUID.
 - (void)getPatchInfo:(NSString *)patchGUID callback:(GetPatchInfoCallback)callback;
 
+// Gets patch metadata for many GUIDs (e.g. every parentGUID in a remix tree) in a single request. Unlike getPatchInfo
+// this is served from PatchCache where possible; every patch fetched by either method is cached under its GUID.
+- (void)getPatchInfoForGUIDs:(NSArray<NSString *> *)patchGUIDs callback:(GetPatchInfoBatchCallback)callback;
+
 // Returns all patches for the currently logged in user.
 - (void)getMyPatches:(GetPatchesCallback)callback;
 
@@ -163,17 +202,77 @@ typedef enum {
 // Returns recently created patches.
 - (void)getRecentPatches:(GetPatchesCallback)callback;
 
+// Paged variants of the above. These return at most limit patches starting after the patch identified by cursor. Pass
+// nil for cursor to get the first page. Each page is cached separately.
+- (void)getMyPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback;
+
+- (void)getPatchesForUserId:(NSInteger)userId limit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback;
+
+- (void)getDocumentationPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback;
+
+- (void)getFeaturedPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback;
+
+- (void)getRecentPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback;
+
 // Downloads patch resource (i.e. the actual content of the file associated with the patch).
 - (void)downloadPatchResource:(Patch *)patch callback:(DownloadResourceCallback)callback;
 
 // Downloads the extra meta-data associated with the patch.
 - (void)downloadPatchExtraData:(Patch *)patch callback:(DownloadResourceCallback)callback;
 
+// Variants of the above that report progress. Downloads that are interrupted by the network are resumed from where they
+// stopped (with an HTTP Range request) rather than started over, both automatically a few times and on a later call.
+- (void)downloadPatchResource:(Patch *)patch progress:(DownloadProgressCallback)progress callback:(DownloadResourceCallback)callback;
+
+- (void)downloadPatchExtraData:(Patch *)patch progress:(DownloadProgressCallback)progress callback:(DownloadResourceCallback)callback;
+
 #pragma mark - World Patches API
 
 // Returns a variety of patches from around the world (based on their latitutde/longitude when uploaded).
 - (void)getWorldPatches:(GetPatchesCallback)callback;
 
+// Paged variant of the above.
+- (void)getWorldPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback;
+
+#pragma mark - Progressive Get Patches API
+
+// Progressive variants of the list calls above. Patches are parsed out of the response as it downloads and handed to
+// the callback batchSize at a time so lists can start filling before the download finishes. Results of these calls
+// are not cached.
+- (void)getPatchesForUserId:(NSInteger)userId batchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback;
+
+- (void)getFeaturedPatchesWithBatchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback;
+
+- (void)getRecentPatchesWithBatchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback;
+
+- (void)getWorldPatchesWithBatchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback;
+
+#pragma mark - Prefetching API
+
+// When count is greater than 0, every list returned by the get patches calls above (from the first batch for the
+// progressive ones) has the patch data and extra data of its first count patches downloaded into PatchCache in the
+// background, so opening one of them does not have to wait for the network. A new list replaces whatever was still
+// waiting to be prefetched for the previous one. Prefetches run at low priority, never use cellular or other metered
+// networks and are not retried; if one fails the rest of that list is skipped. Downloading a resource that is being
+// prefetched turns the prefetch into a regular download. Disabled (0) by default.
+- (void)setPrefetchPatchCount:(NSUInteger)count;
+
+// Maximum number of prefetches that run at the same time. Defaults to 2.
+- (void)setPrefetchMaxConcurrentDownloads:(NSUInteger)maxDownloads;
+
+// Number of bytes prefetching may download per list. Bytes are counted as they arrive: a prefetch whose Content-Length
+// does not fit what is left is cancelled before its body downloads, one that runs over is cancelled there, and no new
+// prefetch starts once the budget is spent. Defaults to 2 MB.
+- (void)setPrefetchByteBudget:(NSUInteger)bytes;
+
+// Prefetches resources of the first patches of patches as described above. The list calls do this by themselves; this
+// is for lists the app puts together itself, e.g. the part of a long list it has scrolled to.
+- (void)prefetchResourcesForPatches:(NSArray *)patches;
+
+// Stops all prefetching until the next list is returned, e.g. when the list it was for scrolls off screen. Prefetches
+// that are running are cancelled; what they downloaded so far is kept and resumed by a later download.
+- (void)cancelPrefetching;
+
 #pragma mark - Create/Modify Patches API
 
 // Creates a new patch.
@@ -188,12 +287,47 @@ typedef enum {
 - (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID hidden:(NSNumber *)isHidden
           patchData:(NSData *)patchData extraMetaData:(NSData *)extraData callback:(CreatePatchCallback)callback;
 
+// Creates a new patch whose data is read from files as it is uploaded rather than from memory, so memory use stays
+// constant no matter how large the files are. Either URL may be nil. These parts are never compressed (see
+// setUploadCompressionEnabled) since that would mean reading them into memory. Fails without making a request if a URL
+// does not point to a readable local regular file.
+- (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID hidden:(NSNumber *)isHidden
+       patchFileURL:(NSURL *)patchFileURL extraMetaDataFileURL:(NSURL *)extraFileURL callback:(CreatePatchCallback)callback;
+
+// Same as above but reads the data from unopened input streams. The length of each stream's content must be known up
+// front as it goes into the request's Content-Length. Either stream may be nil (its length is then ignored).
+- (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID hidden:(NSNumber *)isHidden
+        patchStream:(NSInputStream *)patchStream length:(int64_t)patchLength
+extraMetaDataStream:(NSInputStream *)extraStream length:(int64_t)extraLength callback:(CreatePatchCallback)callback;
+
+// When enabled, updatePatch and deletePatch change the patch and every cached list it is in right away instead of
+// after the service replies, and put everything back if the request fails. The callbacks still report the outcome of
+// the request. Disabled by default.
+- (void)setOptimisticMutationsEnabled:(BOOL)enabled;
+
+// When enabled, patch data and extra data parts of uploadPatch and updatePatch are sent gzip compressed (and marked
+// with a Content-Encoding header on the part) whenever that makes them meaningfully smaller. ChucK source and Auraglyph
+// extra data usually shrink several-fold. The service must support compressed parts. Disabled by default.
+- (void)setUploadCompressionEnabled:(BOOL)enabled;
+
+// When enabled, updatePatch sends changed patch data and extra data as a binary diff (see PatchDelta) against the
+// current revision if that revision's data is cached locally (e.g. it was downloaded or uploaded from this device) and
+// the diff is less than half the size of the data. The full data goes out otherwise. A diff is sent in place of the
+// data as patch_data_delta (or patch_extra_data_delta) together with delta_base_revision, the revision it was made
+// against, and patch_data_sha256 (or patch_extra_data_sha256), the SHA-256 of the full data the service must end up
+// with after applying it. The service must support delta uploads. Disabled by default.
+- (void)setDeltaUploadsEnabled:(BOOL)enabled;
+
 // Update method for a patch that allows updating hidden state, patch name, description, data, and/or meta-data. If a
 // parameter is left nil, it will be ignored and no changes will be made to that particular field.
 //
 // Why is the hidden param a NSNumber instead of BOOL? Because Objective-C annoyingly enough does not have a Boolean
 // class that allows a boolean to nil. So pass nil to skip changing visibility, @(0) to set not hidden, and @(1) to set
 // hidden.
+//
+// Patch data or extra data identical to what this device last downloaded or uploaded for the patch's revision is left
+// out of the request. Instead the request carries patch_data_unchanged_sha256 (or patch_extra_data_unchanged_sha256),
+// the SHA-256 of the data left out, and the service rejects the update if its copy of that part no longer matches.
 - (void)updatePatch:(Patch *)patch hidden:(NSNumber *)isHidden name:(NSString *)name description:(NSString *)description
           patchData:(NSData *)patchData extraMetaData:(NSData *)extraData callback:(UpdatePatchCallback)callback;
 
@@ -218,6 +352,17 @@ typedef enum {
 // getPatchVersions method.
 - (void)downloadPatchVersion:(Patch *)patch version:(NSInteger)version callback:(DownloadResourceCallback)callback;
 
+// Variant of the above that reports progress and resumes interrupted downloads.
+- (void)downloadPatchVersion:(Patch *)patch version:(NSInteger)version progress:(DownloadProgressCallback)progress
+                    callback:(DownloadResourceCallback)callback;
+
+// When enabled, downloadPatchVersion asks for a version as a binary diff (see PatchDelta) against the nearest other
+// version of the same patch already in the disk cache, so browsing a version history mostly transfers deltas. The
+// result is verified against the SHA-256 the service sends along before it is cached or handed back; if there is no
+// cached version to diff against or anything about the delta fails, the full version is downloaded instead. Progress
+// is only reported for full downloads. The service must support delta downloads. Disabled by default.
+- (void)setDeltaDownloadsEnabled:(BOOL)enabled;
+
 #pragma mark - Live API
 
 // Creates a new live session. A string title or arbitrary data (e.g. image) can be associated with the session.
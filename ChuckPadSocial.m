@@ -13,14 +13,100 @@
 #import "ChuckPadSocial.h"
 
 #import "AFHTTPSessionManager.h"
+#import "ChuckPadResponseSerializer.h"
+#import "PatchContentHashes.h"
+#import "PatchDelta.h"
+#import "PatchIdentityMap.h"
+#import "PatchListStreamParser.h"
+#import "RequestDigest.h"
 
-#include <CommonCrypto/CommonDigest.h>
+#include <zlib.h>
 
 static PatchType sPatchType = Unconfigured;
 
+// Network tuning; see configureNetworkWithMaxConnectionsPerHost. Defaults match NSURLSession and AFNetworking's defaults.
+static NSInteger sMaxConnectionsPerHost = 4;
+static NSTimeInterval sRequestTimeout = 60;
+static NSURLRequestCachePolicy sDownloadCachePolicy = NSURLRequestUseProtocolCachePolicy;
+
+// Called with the outcome of a coalesced request; see joinInFlightRequest:waiter:
+typedef void(^InFlightRequestWaiter)(NSURLSessionDataTask *task, id responseObject, NSError *error);
+
+// Maximum number of GUIDs sent in one getPatchInfoForGUIDs request
+static const NSUInteger PATCH_INFO_BATCH_LIMIT = 100;
+
+// Upload parts smaller than this are sent as is since gzip's own overhead would eat most of the savings
+static const NSUInteger UPLOAD_COMPRESSION_MIN_BYTES = 1024;
+
+// Number of times a resource download that fails because of the network is resumed before giving up
+static const NSInteger RESOURCE_DOWNLOAD_MAX_RETRIES = 3;
+
+// Prefetch defaults; see setPrefetchPatchCount
+static const NSUInteger PREFETCH_DEFAULT_MAX_CONCURRENT_DOWNLOADS = 2;
+static const NSUInteger PREFETCH_DEFAULT_BYTE_BUDGET = 2 * 1024 * 1024;
+
+// State of one resource download across its retries. The response and data callbacks run on the download session's
+// delegate queue while everything else runs on the processing queue; see startResourceDownload:
+@interface ResourceDownload : NSObject
+
+@property(nonatomic, retain) NSString *url;
+@property(nonatomic, retain) NSString *cacheKey;
+@property(nonatomic, retain) NSString *requestKey;
+@property(nonatomic, retain) NSMutableArray *progressCallbacks;
+@property(nonatomic, assign) NSInteger retriesRemaining;
+@property(nonatomic, assign) unsigned long long resumeOffset;
+@property(nonatomic, retain) NSFileHandle *fileHandle;
+@property(nonatomic, assign) BOOL fileOpened;
+@property(nonatomic, assign) BOOL writeFailed;
+@property(nonatomic, assign) BOOL rangeMismatch;
+@property(nonatomic, assign) int64_t bytesReceived;
+@property(nonatomic, assign) int64_t totalBytes;
+@property(atomic, retain) NSURLSessionDataTask *dataTask;
+@property(atomic, assign) BOOL isPrefetch;
+
+@end
+
+@implementation ResourceDownload
+@end
+
+// What to do with the response of one task of the download or streaming session; see
+// dataTaskWithSession:request:handler:. The response and data handlers run on the session's delegate queue, the
+// completion handler on the processing queue.
+@interface DataTaskHandler : NSObject
+
+@property(nonatomic, copy) void (^responseHandler)(NSURLResponse *response);
+@property(nonatomic, copy) void (^dataHandler)(NSData *data);
+@property(nonatomic, copy) void (^completionHandler)(NSURLResponse *response, NSError *error);
+
+@end
+
+@implementation DataTaskHandler
+@end
+
+@interface ChuckPadSocial () <NSURLSessionDataDelegate>
+@end
+
 @implementation ChuckPadSocial {
     @private AFHTTPSessionManager *httpSessionManager;
+    @private NSURLSession *downloadSession;
+    @private AFHTTPRequestSerializer *downloadRequestSerializer;
+    @private NSURLSession *streamingSession;
+    @private NSMapTable *taskToDataTaskHandlerMapTable;
+    @private NSMutableDictionary *taskIdentifierToResourceDownloadDictionary;
+    @private NSMutableDictionary *inFlightRequestKeyToWaitersDictionary;
+    @private dispatch_queue_t processingQueue;
+    @private dispatch_queue_t callbackQueue;
     @private NSString *baseUrl;
+    @private BOOL optimisticMutationsEnabled;
+    @private BOOL uploadCompressionEnabled;
+    @private BOOL deltaUploadsEnabled;
+    @private BOOL deltaDownloadsEnabled;
+    @private NSMutableArray *prefetchQueue;
+    @private NSMutableDictionary *requestKeyToPrefetchDownloadDictionary;
+    @private NSUInteger prefetchPatchCount;
+    @private NSUInteger prefetchMaxConcurrentDownloads;
+    @private NSUInteger prefetchByteBudget;
+    @private NSUInteger prefetchBytesRemaining;
     @private NSArray *environmentUrls;
 }
 
@@ -32,6 +118,39 @@ NSInteger SUCCESS_CODE = 200;
 NSInteger ERROR_CODE = 500;
 NSInteger AUTH_ERROR = 400;
 
+// HTTP status codes
+NSInteger HTTP_OK = 200;
+NSInteger HTTP_PARTIAL_CONTENT = 206;
+NSInteger HTTP_NOT_MODIFIED = 304;
+NSInteger HTTP_RANGE_NOT_SATISFIABLE = 416;
+
+// HTTP headers used for conditional GETs
+NSString *const HTTP_HEADER_ETAG = @"ETag";
+NSString *const HTTP_HEADER_LAST_MODIFIED = @"Last-Modified";
+NSString *const HTTP_HEADER_IF_NONE_MATCH = @"If-None-Match";
+NSString *const HTTP_HEADER_IF_MODIFIED_SINCE = @"If-Modified-Since";
+
+// HTTP headers used for resuming downloads
+NSString *const HTTP_HEADER_RANGE = @"Range";
+NSString *const HTTP_HEADER_IF_RANGE = @"If-Range";
+NSString *const HTTP_HEADER_CONTENT_RANGE = @"Content-Range";
+NSString *const HTTP_HEADER_ACCEPT_ENCODING = @"Accept-Encoding";
+NSString *const HTTP_HEADER_CONTENT_ENCODING = @"Content-Encoding";
+
+// Content codings used for upload parts and resource downloads. NSURLSession decodes gzip and deflate responses
+// transparently.
+NSString *const CONTENT_ENCODING_IDENTITY = @"identity";
+NSString *const CONTENT_ENCODING_GZIP = @"gzip";
+NSString *const ACCEPT_ENCODING_COMPRESSED = @"gzip, deflate";
+
+// HTTP headers used for content negotiation
+NSString *const HTTP_HEADER_ACCEPT = @"Accept";
+NSString *const JSON_CONTENT_TYPE = @"application/json";
+
+// HTTP headers the service marks a delta reply to a version download with; see downloadPatchVersion
+NSString *const HTTP_HEADER_DELTA_BASE_VERSION = @"X-Delta-Base-Version";
+NSString *const HTTP_HEADER_CONTENT_SHA256 = @"X-Content-SHA256";
+
 // API URLs
 NSString *const CREATE_USER_URL = @"/user/create";
 NSString *const LOGIN_USER_URL = @"/user/login";
@@ -46,6 +165,7 @@ NSString *const GET_RECENT_URL = @"/patch/new";
 NSString *const GET_MY_PATCHES_URL = @"/patch/my";
 NSString *const GET_PATCHES_FOR_USER_URL = @"/patch/user";
 NSString *const GET_SINGLE_PATCH_INFO = @"/patch/info";
+NSString *const GET_MULTIPLE_PATCH_INFO = @"/patch/info/batch";
 
 NSString *const GET_WORLD_PATCHES = @"/patch/world";
 
@@ -73,6 +193,7 @@ NSString *const ERROR_STRING_LOGGING_OUT = @"There was an error logging out. Ple
 NSString *const ERROR_STRING_NO_EXTRA_RESOURCE = @"This patch does not have any extra data associated with it.";
 NSString *const ERROR_STRING_REPORTING_OWN_PATCH = @"You cannot report a patch that belongs to you.";
 NSString *const ERROR_STRING_ERROR_FETCHING_LIVE_SESSIONS = @"There was an error fetching live sessions. Please try again later.";
+NSString *const ERROR_STRING_UPLOAD_FILE_NOT_READABLE = @"The file to upload could not be read.";
 
 // NSNotification constants
 NSString *const CHUCKPAD_SOCIAL_LOG_IN = @"CHUCKPAD_SOCIAL_LOG_IN";
@@ -91,6 +212,14 @@ NSString *const PARAMS_NEW_PASSWORD = @"new_password";
 NSString *const PATCH_GUID_PARAM_NAME = @"guid";
 NSString *const PATCH_DATA_PARAM_NAME = @"patch_data";
 NSString *const PATCH_EXTRA_DATA_PARAM_NAME = @"patch_extra_data";
+NSString *const PATCH_DATA_UNCHANGED_SHA256_PARAM_NAME = @"patch_data_unchanged_sha256";
+NSString *const PATCH_EXTRA_DATA_UNCHANGED_SHA256_PARAM_NAME = @"patch_extra_data_unchanged_sha256";
+NSString *const PATCH_DATA_DELTA_PARAM_NAME = @"patch_data_delta";
+NSString *const PATCH_EXTRA_DATA_DELTA_PARAM_NAME = @"patch_extra_data_delta";
+NSString *const PATCH_DATA_SHA256_PARAM_NAME = @"patch_data_sha256";
+NSString *const PATCH_EXTRA_DATA_SHA256_PARAM_NAME = @"patch_extra_data_sha256";
+NSString *const PATCH_DELTA_BASE_REVISION_PARAM_NAME = @"delta_base_revision";
+NSString *const PATCH_DELTA_BASE_VERSION_PARAM_NAME = @"delta_base_version";
 NSString *const PATCH_TYPE_PARAM_NAME = @"patch_type";
 NSString *const PATCH_NAME_PARAM_NAME = @"patch_name";
 NSString *const PATCH_DESCRIPTION_PARAM_NAME = @"patch_description";
@@ -101,6 +230,11 @@ NSString *const PATCH_LONGITUDE_PARAM_NAME = @"patch_longitude";
 
 NSString *const IS_ABUSE_PARAM_NAME = @"is_abuse";
 
+NSString *const PATCH_GUIDS_PARAM_NAME = @"guids";
+
+NSString *const PAGE_LIMIT_PARAM_NAME = @"limit";
+NSString *const PAGE_AFTER_PARAM_NAME = @"after";
+
 NSString *const USER_ID_PARAM_KEY = @"user_id";
 NSString *const AUTH_TOKEN_PARAM_KEY = @"auth_token";
 NSString *const TYPE_PARAM_KEY = @"type";
@@ -116,6 +250,13 @@ NSString *const LIVE_SESSION_DATA = @"session_data";
 
 NSString *const FILE_DATA_MIME_TYPE = @"application/octet-stream";
 
++ (void)configureNetworkWithMaxConnectionsPerHost:(NSInteger)maxConnectionsPerHost timeout:(NSTimeInterval)timeout
+                              downloadCachePolicy:(NSURLRequestCachePolicy)downloadCachePolicy {
+    sMaxConnectionsPerHost = maxConnectionsPerHost;
+    sRequestTimeout = timeout;
+    sDownloadCachePolicy = downloadCachePolicy;
+}
+
 + (void)bootstrapForPatchType:(PatchType)patchType {
     if ((sPatchType != Unconfigured && sPatchType != patchType) || patchType == Unconfigured) {
         [NSException raise:@"ChuckPadSocial already bootstrapped"
@@ -137,17 +278,81 @@ static dispatch_once_t onceToken;
 }
 
 - (void)initializeNetworkManager {
-    httpSessionManager = [AFHTTPSessionManager manager];
+    // API calls, progressive list calls and resource downloads each get their own session but all of them are built from
+    // this one configuration.
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    configuration.HTTPMaximumConnectionsPerHost = sMaxConnectionsPerHost;
+    configuration.timeoutIntervalForRequest = sRequestTimeout;
+    
+    // Completion blocks of all three sessions run on processingQueue so mapping responses to model objects (and reading
+    // finished downloads back from disk) never happens on the main queue. Only the final result of a call is handed to
+    // callbackQueue; see onCallbackQueue.
+    processingQueue = dispatch_queue_create("chuckpad-social.processing", DISPATCH_QUEUE_CONCURRENT);
+    callbackQueue = dispatch_get_main_queue();
+    
+    httpSessionManager = [[AFHTTPSessionManager alloc] initWithBaseURL:nil sessionConfiguration:configuration];
+    httpSessionManager.requestSerializer.timeoutInterval = sRequestTimeout;
+    httpSessionManager.completionQueue = processingQueue;
+    
+    // Decodes the "message" envelope together with the response body so the mappers below do not have to
+    httpSessionManager.responseSerializer = [ChuckPadResponseSerializer serializer];
+    [httpSessionManager.requestSerializer setValue:CHUCKPAD_ACCEPT_HEADER_VALUE forHTTPHeaderField:HTTP_HEADER_ACCEPT];
     
     // So the service can uniquely identify iOS calls
     NSString *userAgent = [httpSessionManager.requestSerializer  valueForHTTPHeaderField:@"User-Agent"];
     userAgent = [userAgent stringByAppendingPathComponent:CHUCKPAD_SOCIAL_IOS_USER_AGENT];
     [httpSessionManager.requestSerializer setValue:userAgent forHTTPHeaderField:@"User-Agent"];
     
+    // Tasks of the two plain sessions below report to the handler registered for them; see
+    // dataTaskWithSession:request:handler:
+    taskToDataTaskHandlerMapTable = [NSMapTable strongToStrongObjectsMapTable];
+
+    // Resource downloads are plain unsigned GETs. Bodies are written to a partial file on disk as they arrive so an
+    // interrupted download can be resumed; see startResourceDownload. This is a plain session rather than an
+    // AFHTTPSessionManager, which would also keep every body in memory for its response serializer.
+    downloadRequestSerializer = [AFHTTPRequestSerializer serializer];
+    downloadRequestSerializer.timeoutInterval = sRequestTimeout;
+    downloadRequestSerializer.cachePolicy = sDownloadCachePolicy;
+    [downloadRequestSerializer setValue:userAgent forHTTPHeaderField:@"User-Agent"];
+    downloadSession = [NSURLSession sessionWithConfiguration:configuration delegate:self delegateQueue:nil];
+    taskIdentifierToResourceDownloadDictionary = [[NSMutableDictionary alloc] init];
+
+    prefetchQueue = [[NSMutableArray alloc] init];
+    requestKeyToPrefetchDownloadDictionary = [[NSMutableDictionary alloc] init];
+    prefetchMaxConcurrentDownloads = PREFETCH_DEFAULT_MAX_CONCURRENT_DOWNLOADS;
+    prefetchByteBudget = PREFETCH_DEFAULT_BYTE_BUDGET;
+    
+    // Progressive list calls parse response bodies themselves as bytes arrive. For the same reason as downloads this is
+    // a plain session that hands each chunk to the parser and keeps nothing.
+    streamingSession = [NSURLSession sessionWithConfiguration:configuration delegate:self delegateQueue:nil];
+    inFlightRequestKeyToWaitersDictionary = [[NSMutableDictionary alloc] init];
+    
     environmentUrls = [[NSArray alloc] initWithObjects:EnvironmentHostUrls];
     baseUrl = environmentUrls[[[NSUserDefaults standardUserDefaults] integerForKey:ENVIRONMENT_KEY]];
 }
 
+#pragma mark - Callback Queue
+
+// The queue may be changed while calls are completing on the processing queue so it is only accessed under a lock
+- (void)setCallbackQueue:(dispatch_queue_t)queue {
+    @synchronized (self) {
+        callbackQueue = queue != nil ? queue : dispatch_get_main_queue();
+    }
+}
+
+- (dispatch_queue_t)callbackQueue {
+    @synchronized (self) {
+        return callbackQueue;
+    }
+}
+
+// Every callback goes through here, including those answered right away from PatchCache or because of a bad call, so
+// callers never get called back before the call returns. Results must be fully mapped before calling this so the
+// callback queue (normally the main queue) only ever has to run the caller's own code.
+- (void)onCallbackQueue:(dispatch_block_t)block {
+    dispatch_async([self callbackQueue], block);
+}
+
 #pragma mark - Environment
 
 - (NSString *)getBaseUrl {
@@ -157,6 +362,7 @@ static dispatch_once_t onceToken;
 - (void)setEnvironment:(Environment)environment {
     baseUrl = environmentUrls[environment];
     [[NSUserDefaults standardUserDefaults] setInteger:environment forKey:ENVIRONMENT_KEY];
+    [[ChuckPadKeychain sharedInstance] environmentChanged];
 }
 
 - (void)toggleEnvironment {
@@ -180,7 +386,7 @@ static dispatch_once_t onceToken;
     // If a user is already logged in, do not allow creating another user
     if ([self isLoggedIn]) {
         NSLog(@"createUser - a user is already logged in");
-        callback(false, [self errorWithErrorString:ERROR_STRING_LOGGED_IN_ALREADY]);
+        [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:ERROR_STRING_LOGGED_IN_ALREADY]); }];
         return;
     }
     
@@ -200,7 +406,7 @@ static dispatch_once_t onceToken;
        }
        failure:^(NSURLSessionDataTask *task, NSError *error) {
            NSLog(@"createUser - error: %@", [error localizedDescription]);
-           callback(false, [self errorMakingNetworkCall:error]);
+           [self onCallbackQueue:^{ callback(false, [self errorMakingNetworkCall:error]); }];
        }];
 }
 
@@ -208,7 +414,7 @@ static dispatch_once_t onceToken;
     // If a user is already logged in, do not allow logging in as another user
     if ([self isLoggedIn]) {
         NSLog(@"logIn - a user is already logged in");
-        callback(false, [self errorWithErrorString:ERROR_STRING_LOGGED_IN_ALREADY]);
+        [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:ERROR_STRING_LOGGED_IN_ALREADY]); }];
         return;
     }
     
@@ -231,7 +437,7 @@ static dispatch_once_t onceToken;
        }
        failure:^(NSURLSessionDataTask *task, NSError *error) {
            NSLog(@"logIn - error: %@", [error localizedDescription]);
-           callback(false, [self errorMakingNetworkCall:error]);
+           [self onCallbackQueue:^{ callback(false, [self errorMakingNetworkCall:error]); }];
        }];
 }
 
@@ -239,7 +445,7 @@ static dispatch_once_t onceToken;
     // If not logged in, log an error and abort early
     if (![self isLoggedIn]) {
         NSLog(@"logOut - no user is currently logged in; aborting");
-        callback(false, [self errorWithErrorString:ERROR_STRING_NO_USER_LOGGED_IN]);
+        [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:ERROR_STRING_NO_USER_LOGGED_IN]); }];
         return;
     }
     
@@ -253,14 +459,14 @@ static dispatch_once_t onceToken;
        success:^(NSURLSessionTask *task, id responseObject) {
            if ([self responseOk:responseObject]) {
                [self localLogOut];
-               callback(true, nil);
+               [self onCallbackQueue:^{ callback(true, nil); }];
            } else {
-               callback(false, [self errorWithErrorString:ERROR_STRING_LOGGING_OUT]);
+               [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:ERROR_STRING_LOGGING_OUT]); }];
            }
        }
        failure:^(NSURLSessionTask *operation, NSError *error) {
            NSLog(@"logOut - error: %@", [error localizedDescription]);
-           callback(false, [self errorMakingNetworkCall:error]);
+           [self onCallbackQueue:^{ callback(false, [self errorMakingNetworkCall:error]); }];
        }];
 }
 
@@ -269,9 +475,10 @@ static dispatch_once_t onceToken;
     [[ChuckPadKeychain sharedInstance] clearCredentials];
     
     // Post notification so UI can update itself
-    [[NSNotificationCenter defaultCenter] postNotificationName:CHUCKPAD_SOCIAL_LOG_OUT object:nil userInfo:nil];
+    [self postNotificationOnMainQueue:CHUCKPAD_SOCIAL_LOG_OUT];
     
-    // Flush the cache on user change events
+    // Flush the cache on user change events. Lists can hold the user's hidden patches; the resource data kept on disk
+    // is the same for everyone and stays.
     [[PatchCache sharedInstance] removeAllObjects];
 }
 
@@ -287,21 +494,21 @@ static dispatch_once_t onceToken;
        success:^(NSURLSessionDataTask *task, id responseObject) {
            NSLog(@"forgotPassword - success: %@", responseObject);
            if ([self responseOk:responseObject]) {
-               callback(true, nil);
+               [self onCallbackQueue:^{ callback(true, nil); }];
            } else {
-               callback(false, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+               [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
            }
        }
        failure:^(NSURLSessionDataTask *task, NSError *error) {
            NSLog(@"forgotPassword - error: %@", [error localizedDescription]);
-           callback(false, [self errorMakingNetworkCall:error]);
+           [self onCallbackQueue:^{ callback(false, [self errorMakingNetworkCall:error]); }];
        }];
 }
 
 - (void)changePassword:(NSString *)newPassword callback:(CreateUserCallback)callback {
     // If not logged in, log an error and abort
     if (![self isLoggedIn]) {
-        callback(false, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, [self errorBecauseNotLoggedIn]); }];
         return;
     }
 
@@ -317,14 +524,14 @@ static dispatch_once_t onceToken;
            NSLog(@"changedPassword - success: %@", responseObject);
            if ([self responseOk:responseObject]) {
                // No need to do anything besides notifying caller because our auth token is still valid.
-               callback(true, nil);
+               [self onCallbackQueue:^{ callback(true, nil); }];
            } else {
-               callback(false, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+               [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
            }
        }
        failure:^(NSURLSessionDataTask *task, NSError *error) {
            NSLog(@"changedPassword - error: %@", [error localizedDescription]);
-           callback(false, [self errorMakingNetworkCall:error]);
+           [self onCallbackQueue:^{ callback(false, [self errorMakingNetworkCall:error]); }];
        }];
 }
 
@@ -332,12 +539,25 @@ static dispatch_once_t onceToken;
     [[ChuckPadKeychain sharedInstance] authSucceededWithUser:user];
 
     // Post notification so UI can update itself
-    [[NSNotificationCenter defaultCenter] postNotificationName:CHUCKPAD_SOCIAL_LOG_IN object:nil userInfo:nil];
+    [self postNotificationOnMainQueue:CHUCKPAD_SOCIAL_LOG_IN];
 
-    // Flush the cache on user change events
+    // Flush the cache on user change events. Lists can hold the user's hidden patches; the resource data kept on disk
+    // is the same for everyone and stays.
     [[PatchCache sharedInstance] removeAllObjects];
 }
 
+// Log in and log out can now be triggered from completion blocks on the processing queue but observers of these
+// notifications are UI code.
+- (void)postNotificationOnMainQueue:(NSString *)notificationName {
+    if ([NSThread isMainThread]) {
+        [[NSNotificationCenter defaultCenter] postNotificationName:notificationName object:nil userInfo:nil];
+    } else {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [[NSNotificationCenter defaultCenter] postNotificationName:notificationName object:nil userInfo:nil];
+        });
+    }
+}
+
 #pragma mark - Current User Info
 
 - (NSString *)getLoggedInUserName {
@@ -366,7 +586,7 @@ static dispatch_once_t onceToken;
     // If the user is not logged in, fail now
     if (![self isLoggedIn]) {
         NSLog(@"getMyPatches - no user is currently logged in");
-        callback(false, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, [self errorBecauseNotLoggedIn]); }];
         return;
     }
 
@@ -389,147 +609,946 @@ static dispatch_once_t onceToken;
     [self getPatchesInternal:GET_RECENT_URL withCallback:callback];
 }
 
+- (void)getMyPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback {
+    // If the user is not logged in, fail now
+    if (![self isLoggedIn]) {
+        NSLog(@"getMyPatchesWithLimit - no user is currently logged in");
+        [self onCallbackQueue:^{ callback(nil, nil, [self errorBecauseNotLoggedIn]); }];
+        return;
+    }
+
+    [self getPatchesInternal:GET_MY_PATCHES_URL limit:limit after:cursor withCallback:callback];
+}
+
+- (void)getPatchesForUserId:(NSInteger)userId limit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback {
+    [self getPatchesInternal:[NSString stringWithFormat:@"%@/%ld", GET_PATCHES_FOR_USER_URL, (long)userId] limit:limit after:cursor withCallback:callback];
+}
+
+- (void)getDocumentationPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback {
+    [self getPatchesInternal:GET_DOCUMENTATION_URL limit:limit after:cursor withCallback:callback];
+}
+
+- (void)getFeaturedPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback {
+    [self getPatchesInternal:GET_FEATURED_URL limit:limit after:cursor withCallback:callback];
+}
+
+- (void)getRecentPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback {
+    [self getPatchesInternal:GET_RECENT_URL limit:limit after:cursor withCallback:callback];
+}
+
 - (void)getPatchesInternal:(NSString *)urlPath withCallback:(GetPatchesCallback)callback {
+    [self getPatchesInternal:urlPath limit:0 after:nil withCallback:^(NSArray *patchesArray, NSString *nextCursor, NSError *error) {
+        callback(patchesArray, error);
+    }];
+}
+
+// A limit of 0 fetches the entire list in one response (the original, unpaged behavior).
+- (void)getPatchesInternal:(NSString *)urlPath limit:(NSInteger)limit after:(NSString *)cursor withCallback:(GetPatchesPageCallback)callback {
     NSURL *url = [[NSURL alloc] initWithString:[NSString stringWithFormat:@"%@%@", baseUrl, urlPath]];
 
     NSLog(@"getPatchesInternal - url = %@", url.absoluteString);
 
-    NSArray *patchesArrayFromCache = [[PatchCache sharedInstance] objectForKey:urlPath];
+    // Each page is cached under its own key so paging back through a list does not hit the network again
+    NSString *cacheKey = [self cacheKeyForUrlPath:urlPath limit:limit after:cursor];
+
+    NSArray *patchesArrayFromCache = [[PatchCache sharedInstance] objectForKey:cacheKey];
     if (patchesArrayFromCache != nil && [patchesArrayFromCache count] > 0) {
         NSLog(@"getPatchesInternal - using cached patches array");
-        callback(patchesArrayFromCache, nil);
+        [self prefetchResourcesForPatches:patchesArrayFromCache];
+        [self onCallbackQueue:^{ callback(patchesArrayFromCache, [self nextCursorForPage:patchesArrayFromCache limit:limit], nil); }];
         return;
     }
 
+    // If an expired copy of this list is still around, send its validators along so the service can reply with a 304
+    // and we can reuse the Patch objects we already have instead of downloading and parsing the list again.
+    NSArray *stalePatchesArray = [[PatchCache sharedInstance] staleObjectForKey:cacheKey];
+    NSDictionary *validators = stalePatchesArray != nil ? [[PatchCache sharedInstance] validatorsForKey:cacheKey] : nil;
+
     // Add currentUser params because if a user has hidden patches in any category we want to return them to the user.
     NSMutableDictionary *requestParams = [self getCurrentUserAuthParamsDictionary];
+    [self appendPageParamsToRequestParams:requestParams limit:limit after:cursor];
 
-    [self GET:url.absoluteString parameters:requestParams progress:nil
-      success:^(NSURLSessionTask *task, id responseObject) {
-          if ([self responseOk:responseObject]) {
+    NSString *requestKey = [self inFlightRequestKeyForMethod:@"GET" url:url.absoluteString parameters:requestParams extra:validators];
+    if ([self joinInFlightRequest:requestKey waiter:^(NSURLSessionDataTask *task, id patchesArray, NSError *error) {
+        [self onCallbackQueue:^{ callback(patchesArray, [self nextCursorForPage:patchesArray limit:limit], error); }];
+    }]) {
+        NSLog(@"getPatchesInternal - joined in-flight request");
+        return;
+    }
+
+    [self GET:url.absoluteString parameters:requestParams validators:validators
+      success:^(NSURLSessionDataTask *task, id responseObject) {
+          if ([self isNotModifiedResponse:task.response]) {
+              NSLog(@"getPatchesInternal - patches not modified; reusing cached patches array");
+              [[PatchCache sharedInstance] setObject:stalePatchesArray forKey:cacheKey];
+              [self prefetchResourcesForPatches:stalePatchesArray];
+              [self completeInFlightRequest:requestKey task:task responseObject:stalePatchesArray error:nil];
+          } else if ([self responseOk:responseObject]) {
               NSMutableArray *patchesArray = [[NSMutableArray alloc] init];
               for (id object in [self getPatchListFromMessageResponse:responseObject]) {
-                  Patch *patch = [[Patch alloc] initWithDictionary:object];
+                  Patch *patch = [[PatchIdentityMap sharedInstance] patchForDictionary:object];
                   [patchesArray addObject:patch];
               }
               
               NSLog(@"getPatchesInternal - fetched %lu patches", (unsigned long)[patchesArray count]);
               
               // Save response to our cache in case we hit this API again soon
-              [[PatchCache sharedInstance] setObject:patchesArray forKey:urlPath];
+              [[PatchCache sharedInstance] setObject:patchesArray forKey:cacheKey];
+              [[PatchCache sharedInstance] setValidators:[self validatorsFromResponse:task.response] forKey:cacheKey];
               
-              callback(patchesArray, nil);
+              [self prefetchResourcesForPatches:patchesArray];
+              [self completeInFlightRequest:requestKey task:task responseObject:patchesArray error:nil];
           } else {
-              callback(nil, [self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]);
+              [self completeInFlightRequest:requestKey task:task responseObject:nil
+                                      error:[self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]];
           }
       }
-      failure:^(NSURLSessionTask *operation, NSError *error) {
+      failure:^(NSURLSessionDataTask *task, NSError *error) {
           NSLog(@"getPatchesInternal - error: %@", [error localizedDescription]);
-          callback(nil, [self errorMakingNetworkCall:error]);
+          [self completeInFlightRequest:requestKey task:task responseObject:nil error:[self errorMakingNetworkCall:error]];
       }];
 }
 
 - (void)getWorldPatches:(GetPatchesCallback)callback {
+    [self getWorldPatchesWithLimit:0 after:nil callback:^(NSArray *patchesArray, NSString *nextCursor, NSError *error) {
+        callback(patchesArray, error);
+    }];
+}
+
+- (void)getWorldPatchesWithLimit:(NSInteger)limit after:(NSString *)cursor callback:(GetPatchesPageCallback)callback {
     NSString *url = [NSString stringWithFormat:@"%@%@", [[ChuckPadSocial sharedInstance] getBaseUrl], GET_WORLD_PATCHES];
     
     NSMutableDictionary *requestParams = [self getBaseRequestDictionary];
+    [self appendPageParamsToRequestParams:requestParams limit:limit after:cursor];
+
+    NSString *requestKey = [self inFlightRequestKeyForMethod:@"GET" url:url parameters:requestParams extra:nil];
+    if ([self joinInFlightRequest:requestKey waiter:^(NSURLSessionDataTask *task, id patchesArray, NSError *error) {
+        [self onCallbackQueue:^{ callback(patchesArray, [self nextCursorForPage:patchesArray limit:limit], error); }];
+    }]) {
+        NSLog(@"getWorldPatches - joined in-flight request");
+        return;
+    }
 
     [self GET:url parameters:requestParams progress:nil
-      success:^(NSURLSessionTask *task, id responseObject) {
+      success:^(NSURLSessionDataTask *task, id responseObject) {
           if ([self responseOk:responseObject]) {
               NSMutableArray *patchesArray = [[NSMutableArray alloc] init];
               for (id object in [self getPatchListFromMessageResponse:responseObject]) {
-                  Patch *patch = [[Patch alloc] initWithDictionary:object];
+                  Patch *patch = [[PatchIdentityMap sharedInstance] patchForDictionary:object];
                   [patchesArray addObject:patch];
               }
-              callback(patchesArray, nil);
+              [self prefetchResourcesForPatches:patchesArray];
+              [self completeInFlightRequest:requestKey task:task responseObject:patchesArray error:nil];
           } else {
-              callback(nil, [self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]);
+              [self completeInFlightRequest:requestKey task:task responseObject:nil
+                                      error:[self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]];
           }
       }
-      failure:^(NSURLSessionTask *operation, NSError *error) {
+      failure:^(NSURLSessionDataTask *task, NSError *error) {
           NSLog(@"getWorldPatches - error: %@", [error localizedDescription]);
-          callback(nil, [self errorMakingNetworkCall:error]);
+          [self completeInFlightRequest:requestKey task:task responseObject:nil error:[self errorMakingNetworkCall:error]];
       }];
 }
 
+#pragma mark - Patches API - Progressive Fetching
+
+- (void)getPatchesForUserId:(NSInteger)userId batchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback {
+    [self getPatchesProgressivelyInternal:[NSString stringWithFormat:@"%@/%ld", GET_PATCHES_FOR_USER_URL, (long)userId]
+                           requestParams:[self getCurrentUserAuthParamsDictionary] batchSize:batchSize callback:callback];
+}
+
+- (void)getFeaturedPatchesWithBatchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback {
+    [self getPatchesProgressivelyInternal:GET_FEATURED_URL requestParams:[self getCurrentUserAuthParamsDictionary]
+                               batchSize:batchSize callback:callback];
+}
+
+- (void)getRecentPatchesWithBatchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback {
+    [self getPatchesProgressivelyInternal:GET_RECENT_URL requestParams:[self getCurrentUserAuthParamsDictionary]
+                               batchSize:batchSize callback:callback];
+}
+
+- (void)getWorldPatchesWithBatchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback {
+    [self getPatchesProgressivelyInternal:GET_WORLD_PATCHES requestParams:[self getBaseRequestDictionary]
+                               batchSize:batchSize callback:callback];
+}
+
+// Unlike getPatchesInternal this never holds the whole list at once so the result is not written to PatchCache. A
+// list that is already cached is still served from there in a single finished batch.
+- (void)getPatchesProgressivelyInternal:(NSString *)urlPath requestParams:(NSMutableDictionary *)requestParams
+                              batchSize:(NSUInteger)batchSize callback:(GetPatchesProgressiveCallback)callback {
+    NSURL *url = [[NSURL alloc] initWithString:[NSString stringWithFormat:@"%@%@", baseUrl, urlPath]];
+
+    NSLog(@"getPatchesProgressivelyInternal - url = %@", url.absoluteString);
+
+    NSArray *patchesArrayFromCache = [[PatchCache sharedInstance] objectForKey:urlPath];
+    if (patchesArrayFromCache != nil && [patchesArrayFromCache count] > 0) {
+        NSLog(@"getPatchesProgressivelyInternal - using cached patches array");
+        [self prefetchResourcesForPatches:patchesArrayFromCache];
+        [self onCallbackQueue:^{ callback(patchesArrayFromCache, YES, nil); }];
+        return;
+    }
+
+    // Batches are parsed on the session's delegate queue and delivered on the callback queue. The completion blocks below
+    // only run after the last chunk was parsed so (as long as the callback queue is serial) the final callback always
+    // arrives after every batch. Only the first batch (the top of the list) is prefetched from; batches are handed over
+    // one at a time so the flag needs no locking.
+    __block BOOL prefetched = NO;
+    PatchListStreamParser *parser = [[PatchListStreamParser alloc] initWithBatchSize:batchSize batchHandler:^(NSArray *patchesBatch) {
+        if (!prefetched) {
+            prefetched = YES;
+            [self prefetchResourcesForPatches:patchesBatch];
+        }
+        [self onCallbackQueue:^{ callback(patchesBatch, NO, nil); }];
+    }];
+
+    [self streamingGET:url.absoluteString parameters:requestParams parser:parser
+               success:^(NSURLSessionDataTask *task) {
+                   NSArray *remainingPatches = [parser finish];
+                   if (parser.error == nil && [self responseOk:@{ @"code" : @(parser.responseCode) }]) {
+                       NSLog(@"getPatchesProgressivelyInternal - fetched %lu patches", (unsigned long)parser.patchCount);
+                       if (!prefetched) {
+                           [self prefetchResourcesForPatches:remainingPatches];
+                       }
+                       [self onCallbackQueue:^{ callback(remainingPatches, YES, nil); }];
+                   } else {
+                       [self onCallbackQueue:^{ callback(nil, YES, [self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]); }];
+                   }
+               }
+               failure:^(NSURLSessionDataTask *task, NSError *error) {
+                   NSLog(@"getPatchesProgressivelyInternal - error: %@", [error localizedDescription]);
+                   [self onCallbackQueue:^{ callback(nil, YES, [self errorMakingNetworkCall:error]); }];
+               }];
+}
+
+#pragma mark - Patches API - Paging Helpers
+
+- (NSString *)cacheKeyForUrlPath:(NSString *)urlPath limit:(NSInteger)limit after:(NSString *)cursor {
+    if (limit <= 0) {
+        return urlPath;
+    }
+    return [NSString stringWithFormat:@"%@?%@=%ld&%@=%@", urlPath, PAGE_LIMIT_PARAM_NAME, (long)limit, PAGE_AFTER_PARAM_NAME, cursor ?: @""];
+}
+
+- (void)appendPageParamsToRequestParams:(NSMutableDictionary *)requestParams limit:(NSInteger)limit after:(NSString *)cursor {
+    if (limit <= 0) {
+        return;
+    }
+
+    requestParams[PAGE_LIMIT_PARAM_NAME] = @(limit);
+    if (cursor != nil) {
+        requestParams[PAGE_AFTER_PARAM_NAME] = cursor;
+    }
+}
+
+// Lists are paged by patch GUID: the cursor for the next page is the GUID of the last patch on this page. A page that
+// comes back short means we have reached the end of the list.
+- (NSString *)nextCursorForPage:(NSArray *)patchesArray limit:(NSInteger)limit {
+    if (limit <= 0 || [patchesArray count] < limit) {
+        return nil;
+    }
+    return ((Patch *)[patchesArray lastObject]).guid;
+}
+
 - (void)getPatchInfo:(NSString *)patchGUID callback:(GetPatchInfoCallback)callback {
     NSURL *url = [[NSURL alloc] initWithString:[NSString stringWithFormat:@"%@%@/%@", baseUrl, GET_SINGLE_PATCH_INFO, patchGUID]];
     
     NSLog(@"getPatchInfo - url = %@", url.absoluteString);
 
-    // Do not use cache here because we want to ensure we always return fresh metadata.
-    
-    [self GET:url.absoluteString parameters:[self getBaseRequestDictionary] progress:nil
-      success:^(NSURLSessionTask *task, id responseObject) {
+    // Do not use cache here because we want to ensure we always return fresh metadata. A request that is already in
+    // flight is just as fresh though.
+    NSMutableDictionary *requestParams = [self getBaseRequestDictionary];
+    NSString *requestKey = [self inFlightRequestKeyForMethod:@"GET" url:url.absoluteString parameters:requestParams extra:nil];
+    if ([self joinInFlightRequest:requestKey waiter:^(NSURLSessionDataTask *task, id patch, NSError *error) {
+        [self onCallbackQueue:^{ callback(error == nil, patch, error); }];
+    }]) {
+        NSLog(@"getPatchInfo - joined in-flight request");
+        return;
+    }
+
+    [self GET:url.absoluteString parameters:requestParams progress:nil
+      success:^(NSURLSessionDataTask *task, id responseObject) {
           if ([self responseOk:responseObject]) {
               Patch *patch = [self getPatchFromMessageResponse:responseObject];
-              callback(YES, patch, nil);
+              [[PatchCache sharedInstance] setObject:patch forKey:[self cacheKeyForPatchInfo:patch.guid]];
+              [self completeInFlightRequest:requestKey task:task responseObject:patch error:nil];
           } else {
-              callback(NO, nil, [self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]);
+              [self completeInFlightRequest:requestKey task:task responseObject:nil
+                                      error:[self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]];
           }
       }
-      failure:^(NSURLSessionTask *operation, NSError *error) {
+      failure:^(NSURLSessionDataTask *task, NSError *error) {
           NSLog(@"getPatchInfo - error: %@", [error localizedDescription]);
-          callback(NO, nil, [self errorMakingNetworkCall:error]);
+          [self completeInFlightRequest:requestKey task:task responseObject:nil error:[self errorMakingNetworkCall:error]];
       }];
 }
 
+- (void)getPatchInfoForGUIDs:(NSArray<NSString *> *)patchGUIDs callback:(GetPatchInfoBatchCallback)callback {
+    NSMutableDictionary *guidToPatchDictionary = [[NSMutableDictionary alloc] init];
+    NSMutableOrderedSet *guidsToFetch = [[NSMutableOrderedSet alloc] init];
+
+    for (NSString *patchGUID in patchGUIDs) {
+        Patch *patchFromCache = [[PatchCache sharedInstance] objectForKey:[self cacheKeyForPatchInfo:patchGUID]];
+        if (patchFromCache != nil) {
+            guidToPatchDictionary[patchGUID] = patchFromCache;
+        } else {
+            [guidsToFetch addObject:patchGUID];
+        }
+    }
+
+    NSLog(@"getPatchInfoForGUIDs - %lu cached, %lu to fetch", (unsigned long)[guidToPatchDictionary count], (unsigned long)[guidsToFetch count]);
+
+    if ([guidsToFetch count] == 0) {
+        [self onCallbackQueue:^{ callback(YES, guidToPatchDictionary, nil); }];
+        return;
+    }
+
+    NSURL *url = [[NSURL alloc] initWithString:[NSString stringWithFormat:@"%@%@", baseUrl, GET_MULTIPLE_PATCH_INFO]];
+
+    // GUIDs go in the query string so very long lists are split over a few requests that run side by side
+    dispatch_group_t group = dispatch_group_create();
+    __block NSError *batchError = nil;
+
+    NSArray *allGUIDsToFetch = [guidsToFetch array];
+    for (NSUInteger start = 0; start < [allGUIDsToFetch count]; start += PATCH_INFO_BATCH_LIMIT) {
+        NSArray *guids = [allGUIDsToFetch subarrayWithRange:NSMakeRange(start, MIN(PATCH_INFO_BATCH_LIMIT, [allGUIDsToFetch count] - start))];
+
+        NSMutableDictionary *requestParams = [self getBaseRequestDictionary];
+        requestParams[PATCH_GUIDS_PARAM_NAME] = [guids componentsJoinedByString:@","];
+
+        // Identical batches requested by overlapping calls share one request; each call merges the mapped patches
+        dispatch_group_enter(group);
+        NSString *requestKey = [self inFlightRequestKeyForMethod:@"GET" url:url.absoluteString parameters:requestParams extra:nil];
+        if ([self joinInFlightRequest:requestKey waiter:^(NSURLSessionDataTask *task, id patchesArray, NSError *error) {
+            @synchronized (guidToPatchDictionary) {
+                if (error != nil) {
+                    batchError = error;
+                }
+                for (Patch *patch in patchesArray) {
+                    guidToPatchDictionary[patch.guid] = patch;
+                }
+            }
+            dispatch_group_leave(group);
+        }]) {
+            NSLog(@"getPatchInfoForGUIDs - joined in-flight request");
+            continue;
+        }
+
+        [self GET:url.absoluteString parameters:requestParams progress:nil
+          success:^(NSURLSessionDataTask *task, id responseObject) {
+              if ([self responseOk:responseObject]) {
+                  NSMutableArray *patchesArray = [[NSMutableArray alloc] init];
+                  for (id object in [self getPatchListFromMessageResponse:responseObject]) {
+                      Patch *patch = [[PatchIdentityMap sharedInstance] patchForDictionary:object];
+                      if (patch.guid != nil) {
+                          [[PatchCache sharedInstance] setObject:patch forKey:[self cacheKeyForPatchInfo:patch.guid]];
+                          [patchesArray addObject:patch];
+                      }
+                  }
+                  [self completeInFlightRequest:requestKey task:task responseObject:patchesArray error:nil];
+              } else {
+                  [self completeInFlightRequest:requestKey task:task responseObject:nil
+                                          error:[self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_PATCHES]];
+              }
+          }
+          failure:^(NSURLSessionDataTask *task, NSError *error) {
+              NSLog(@"getPatchInfoForGUIDs - error: %@", [error localizedDescription]);
+              [self completeInFlightRequest:requestKey task:task responseObject:nil error:[self errorMakingNetworkCall:error]];
+          }];
+    }
+
+    // Batch waiters run concurrently on the processing queue so they lock the dictionary and error above. The group is
+    // only notified once all of them have finished.
+    dispatch_group_notify(group, [self callbackQueue], ^{
+        if (batchError != nil) {
+            callback(NO, nil, batchError);
+        } else {
+            callback(YES, guidToPatchDictionary, nil);
+        }
+    });
+}
+
+- (NSString *)cacheKeyForPatchInfo:(NSString *)patchGUID {
+    return [NSString stringWithFormat:@"%@/%@", GET_SINGLE_PATCH_INFO, patchGUID];
+}
+
 - (void)downloadPatchResource:(Patch *)patch callback:(DownloadResourceCallback)callback {
+    [self downloadPatchResource:patch progress:nil callback:callback];
+}
+
+- (void)downloadPatchResource:(Patch *)patch progress:(DownloadProgressCallback)progress callback:(DownloadResourceCallback)callback {
     NSString *url = [NSString stringWithFormat:@"%@%@", [[ChuckPadSocial sharedInstance] getBaseUrl], patch.resourceUrl];
-    [self getData:url callback:callback];
+    [self getData:url cacheKey:[self cacheKeyForUrl:url revision:patch.revision] progress:progress
+         callback:[self callback:callback recordingContentHashForPart:PATCH_DATA_PARAM_NAME ofPatch:patch]];
+}
+
+- (void)downloadPatchExtraData:(Patch *)patch callback:(DownloadResourceCallback)callback {
+    [self downloadPatchExtraData:patch progress:nil callback:callback];
+}
+
+- (void)downloadPatchExtraData:(Patch *)patch progress:(DownloadProgressCallback)progress callback:(DownloadResourceCallback)callback {
+    if (![patch hasExtraResource]) {
+        NSLog(@"downloadPatchExtraData - this patch does not have an extra resource");
+        [self onCallbackQueue:^{ callback(nil, [self errorWithErrorString:ERROR_STRING_NO_EXTRA_RESOURCE]); }];
+        return;
+    }
+    
+    NSString *url = [NSString stringWithFormat:@"%@%@", [[ChuckPadSocial sharedInstance] getBaseUrl], patch.extraResourceUrl];
+    [self getData:url cacheKey:[self cacheKeyForUrl:url revision:patch.revision] progress:progress
+         callback:[self callback:callback recordingContentHashForPart:PATCH_EXTRA_DATA_PARAM_NAME ofPatch:patch]];
+}
+
+// Remembers the hash of what was downloaded so a later updatePatch with the same bytes can leave them out. Hashing is
+// done on the processing queue and only if nothing is recorded for this revision yet.
+- (DownloadResourceCallback)callback:(DownloadResourceCallback)callback recordingContentHashForPart:(NSString *)part ofPatch:(Patch *)patch {
+    NSString *guid = patch.guid;
+    NSInteger revision = patch.revision;
+    return ^(NSData *resourceData, NSError *error) {
+        PatchContentHashes *contentHashes = [PatchContentHashes sharedInstance];
+        if (resourceData != nil && [contentHashes hashForPart:part ofPatchWithGUID:guid revision:revision] == nil) {
+            dispatch_async(processingQueue, ^{
+                [contentHashes setHash:[PatchContentHashes SHA256HexDigestForData:resourceData] forPart:part ofPatchWithGUID:guid revision:revision];
+            });
+        }
+        callback(resourceData, error);
+    };
+}
+
+// Resource URLs stay the same across revisions of a patch so the revision is folded into the cache key. This keeps
+// every key pointing at immutable content which is what allows PatchCache to persist it to its disk tier.
+- (NSString *)cacheKeyForUrl:(NSString *)url revision:(NSInteger)revision {
+    return [NSString stringWithFormat:@"%@#%ld", url, (long)revision];
 }
 
-- (void)downloadPatchExtraData:(Patch *)patch callback:(DownloadResourceCallback)callback {
-    if (![patch hasExtraResource]) {
-        NSLog(@"downloadPatchExtraData - this patch does not have an extra resource");
-        callback(nil, [self errorWithErrorString:ERROR_STRING_NO_EXTRA_RESOURCE]);
-        return;
+- (void)getData:(NSString *)url cacheKey:(NSString *)cacheKey progress:(DownloadProgressCallback)progress callback:(DownloadResourceCallback)callback {
+    NSLog(@"getData - url = %@", url);
+
+    // A memory miss reads the disk tier, which can mean several MB, so the lookup stays off the caller's thread
+    dispatch_async(processingQueue, ^{
+        NSData *patchDataFromCache = [[PatchCache sharedInstance] dataForKey:cacheKey];
+        if (patchDataFromCache != nil) {
+            NSLog(@"getData - using cached data");
+            [self onCallbackQueue:^{ callback(patchDataFromCache, nil); }];
+            return;
+        }
+
+        NSString *requestKey = [self requestKeyForResourceWithCacheKey:cacheKey];
+        if ([self joinResourceDownload:requestKey progress:progress callback:callback]) {
+            NSLog(@"getData - joined in-flight download");
+            return;
+        }
+
+        [self startResourceDownloadForUrl:url cacheKey:cacheKey requestKey:requestKey progress:progress];
+    });
+}
+
+- (NSString *)requestKeyForResourceWithCacheKey:(NSString *)cacheKey {
+    return [NSString stringWithFormat:@"DATA %@", cacheKey];
+}
+
+// If the same resource is already being downloaded, waits for that download instead of starting another one. Returns
+// NO if the caller is the first and must start the download itself; see joinInFlightRequest:waiter:
+- (BOOL)joinResourceDownload:(NSString *)requestKey progress:(DownloadProgressCallback)progress callback:(DownloadResourceCallback)callback {
+    if (![self joinInFlightRequest:requestKey waiter:^(NSURLSessionDataTask *task, id responseObject, NSError *error) {
+        [self onCallbackQueue:^{ callback(responseObject, error); }];
+    }]) {
+        return NO;
+    }
+
+    [self promotePrefetchDownloadWithRequestKey:requestKey];
+    if (progress != nil) {
+        [self addProgressCallback:progress toResourceDownloadWithRequestKey:requestKey];
+    }
+    return YES;
+}
+
+- (void)startResourceDownloadForUrl:(NSString *)url cacheKey:(NSString *)cacheKey requestKey:(NSString *)requestKey
+                           progress:(DownloadProgressCallback)progress {
+    ResourceDownload *download = [[ResourceDownload alloc] init];
+    download.url = url;
+    download.cacheKey = cacheKey;
+    download.requestKey = requestKey;
+    download.progressCallbacks = [[NSMutableArray alloc] init];
+    download.retriesRemaining = RESOURCE_DOWNLOAD_MAX_RETRIES;
+    if (progress != nil) {
+        [download.progressCallbacks addObject:[progress copy]];
+    }
+
+    [self startResourceDownload:download];
+}
+
+#pragma mark - Resumable Downloads
+
+// Downloads are written to a partial file (see PatchDiskCache) as bytes arrive. If a previous attempt left one behind,
+// and we know the validators of the response it came from, only the remaining bytes are requested with a Range header.
+// If-Range makes the service send the whole resource instead if it has changed since. Attempts that fail because of
+// the network are resumed the same way a few times before the download is reported as failed. The partial file is
+// kept after a final failure so the next download of the same resource picks up where this one stopped.
+- (void)startResourceDownload:(ResourceDownload *)download {
+    PatchDiskCache *diskCache = [PatchDiskCache sharedInstance];
+    NSString *partialPath = [diskCache partialDataPathForKey:download.cacheKey];
+    NSDictionary *validators = [diskCache partialDataValidatorsForKey:download.cacheKey];
+    NSString *ifRange = validators[HTTP_HEADER_ETAG] ?: validators[HTTP_HEADER_LAST_MODIFIED];
+
+    unsigned long long resumeOffset = 0;
+    if (ifRange != nil) {
+        resumeOffset = [[[NSFileManager defaultManager] attributesOfItemAtPath:partialPath error:nil] fileSize];
+    }
+    download.resumeOffset = resumeOffset;
+    download.fileOpened = NO;
+    download.writeFailed = NO;
+    download.rangeMismatch = NO;
+
+    NSError *serializationError = nil;
+    NSMutableURLRequest *request = [downloadRequestSerializer requestWithMethod:@"GET" URLString:download.url
+                                                                     parameters:nil error:&serializationError];
+    if (serializationError != nil) {
+        [self completeInFlightRequest:download.requestKey task:nil responseObject:nil
+                                error:[self errorWithErrorString:ERROR_STRING_ERROR_DOWNLOADING_PATCH_RESOURCE]];
+        return;
+    }
+
+    // A fresh download may come back compressed. Byte offsets only line up across attempts for the unencoded
+    // representation though, so resumed attempts ask for that; see resourceDownload:didReceiveResponse:
+    [request setValue:(resumeOffset > 0 ? CONTENT_ENCODING_IDENTITY : ACCEPT_ENCODING_COMPRESSED) forHTTPHeaderField:HTTP_HEADER_ACCEPT_ENCODING];
+
+    if (resumeOffset > 0) {
+        NSLog(@"startResourceDownload - resuming %@ at byte %llu", download.url, resumeOffset);
+        request.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+        [request setValue:[NSString stringWithFormat:@"bytes=%llu-", resumeOffset] forHTTPHeaderField:HTTP_HEADER_RANGE];
+        [request setValue:ifRange forHTTPHeaderField:HTTP_HEADER_IF_RANGE];
+    }
+
+    // Nobody asked for a prefetch yet so it must not cost the user anything; see prefetchResourcesForPatches:
+    if (download.isPrefetch) {
+        request.allowsCellularAccess = NO;
+        if (@available(iOS 13.0, *)) {
+            request.allowsExpensiveNetworkAccess = NO;
+            request.allowsConstrainedNetworkAccess = NO;
+        }
+    }
+
+    __block NSURLSessionDataTask *dataTask = nil;
+    DataTaskHandler *handler = [[DataTaskHandler alloc] init];
+    handler.responseHandler = ^(NSURLResponse *response) {
+        [self resourceDownload:download didReceiveResponse:response];
+    };
+    handler.dataHandler = ^(NSData *data) {
+        [self resourceDownload:download didReceiveData:data];
+    };
+    handler.completionHandler = ^(NSURLResponse *response, NSError *error) {
+        [self setResourceDownload:nil forTask:dataTask];
+        [download.fileHandle closeFile];
+        download.fileHandle = nil;
+        download.dataTask = nil;
+        [self resourceDownload:download didCompleteWithResponse:response error:error];
+    };
+
+    dataTask = [self dataTaskWithSession:downloadSession request:request handler:handler];
+
+    dataTask.priority = download.isPrefetch ? NSURLSessionTaskPriorityLow : NSURLSessionTaskPriorityDefault;
+    download.dataTask = dataTask;
+    [self setResourceDownload:download forTask:dataTask];
+    [dataTask resume];
+}
+
+- (void)resourceDownload:(ResourceDownload *)download didCompleteWithResponse:(NSURLResponse *)response error:(NSError *)error {
+    PatchDiskCache *diskCache = [PatchDiskCache sharedInstance];
+    NSInteger statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? [(NSHTTPURLResponse *)response statusCode] : -1;
+
+    // The body only went to the partial file if this attempt got a 200, or a 206 continuing it, and the file could be
+    // opened (see didReceiveResponse). Any other 2xx reply leaves behind whatever an earlier attempt wrote, which must
+    // not pass for the resource.
+    BOOL bodyWritten = download.fileOpened && (statusCode == HTTP_OK || statusCode == HTTP_PARTIAL_CONTENT);
+    if (error == nil) {
+        NSData *data = bodyWritten ? [NSData dataWithContentsOfFile:[diskCache partialDataPathForKey:download.cacheKey]] : nil;
+        [diskCache removePartialDataForKey:download.cacheKey];
+
+        if (data != nil) {
+            [[PatchCache sharedInstance] setData:data forKey:download.cacheKey];
+            [self completeInFlightRequest:download.requestKey task:nil responseObject:data error:nil];
+        } else {
+            [self completeInFlightRequest:download.requestKey task:nil responseObject:nil
+                                    error:[self errorWithErrorString:ERROR_STRING_ERROR_DOWNLOADING_PATCH_RESOURCE]];
+        }
+        return;
+    }
+
+    NSLog(@"resourceDownload - error: %@", [error localizedDescription]);
+
+    // We cancelled the download because the partial file could not be written (e.g. the disk is full). What made it
+    // into the file cannot be trusted and retrying would likely fail the same way.
+    if (download.writeFailed) {
+        [diskCache removePartialDataForKey:download.cacheKey];
+        [self completeInFlightRequest:download.requestKey task:nil responseObject:nil
+                                error:[self errorWithErrorString:ERROR_STRING_ERROR_DOWNLOADING_PATCH_RESOURCE]];
+        return;
+    }
+
+    // Our partial file no longer matches the resource on the service, or the service sent some other range than the one
+    // we asked for, so start over from the beginning
+    BOOL restart = statusCode == HTTP_RANGE_NOT_SATISFIABLE || download.rangeMismatch;
+    if (restart) {
+        [diskCache removePartialDataForKey:download.cacheKey];
+    }
+
+    // Only network failures (and the restart above) are worth retrying; any other HTTP error will just happen again
+    BOOL isNetworkError = [error.domain isEqualToString:NSURLErrorDomain] && error.code != NSURLErrorCancelled;
+    if ((isNetworkError || restart) && download.retriesRemaining > 0) {
+        NSInteger attempt = RESOURCE_DOWNLOAD_MAX_RETRIES - download.retriesRemaining + 1;
+        download.retriesRemaining--;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, attempt * NSEC_PER_SEC), processingQueue, ^{
+            [self startResourceDownload:download];
+        });
+        return;
+    }
+
+    [self completeInFlightRequest:download.requestKey task:nil responseObject:nil
+                            error:[self errorWithErrorString:ERROR_STRING_ERROR_DOWNLOADING_PATCH_RESOURCE]];
+}
+
+// Called on the download session's delegate queue before any body bytes arrive. A 206 reply continues the partial file
+// where it left off while a 200 reply (a fresh download, or If-Range telling us the resource changed) replaces it.
+- (void)resourceDownload:(ResourceDownload *)download didReceiveResponse:(NSURLResponse *)response {
+    if (download == nil || ![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return;
+    }
+
+    PatchDiskCache *diskCache = [PatchDiskCache sharedInstance];
+    NSString *partialPath = [diskCache partialDataPathForKey:download.cacheKey];
+    NSInteger statusCode = [(NSHTTPURLResponse *)response statusCode];
+
+    // Checked before the partial file is touched so a prefetch cancelled here leaves it as it was
+    if (download.isPrefetch && response.expectedContentLength != NSURLResponseUnknownLength &&
+        ![self prefetchDownload:download withinBudgetForBytes:(uint64_t)response.expectedContentLength charge:NO]) {
+        return;
+    }
+
+    if (statusCode == HTTP_PARTIAL_CONTENT && download.resumeOffset > 0) {
+        // Bytes of any other range (e.g. from a proxy that ignored ours) would land at the wrong offset of the file
+        if ([self startOfContentRangeInResponse:response] != (long long)download.resumeOffset) {
+            NSLog(@"resourceDownload - %@ came back with a different range than requested, starting over", download.url);
+            download.rangeMismatch = YES;
+            [download.dataTask cancel];
+            return;
+        }
+
+        download.fileHandle = [NSFileHandle fileHandleForWritingAtPath:partialPath];
+        [download.fileHandle truncateFileAtOffset:download.resumeOffset];
+        download.bytesReceived = download.resumeOffset;
+    } else if (statusCode == HTTP_OK) {
+        // NSURLSession hands us decoded bytes, so the partial file of a compressed response cannot be resumed with a
+        // Range request (which counts bytes of the encoded representation). Leaving out the validators means the next
+        // attempt starts over instead.
+        BOOL isEncoded = [self isEncodedResponse:response];
+        [[NSFileManager defaultManager] createFileAtPath:partialPath contents:nil attributes:nil];
+        [diskCache setPartialDataValidators:(isEncoded ? nil : [self validatorsFromResponse:response]) forKey:download.cacheKey];
+        download.fileHandle = [NSFileHandle fileHandleForWritingAtPath:partialPath];
+        download.bytesReceived = 0;
+    } else {
+        return;
+    }
+    download.fileOpened = download.fileHandle != nil;
+
+    // Content-Length of a compressed response is its encoded size which says nothing about how many bytes we will get
+    int64_t expectedLength = [self isEncodedResponse:response] ? NSURLResponseUnknownLength : response.expectedContentLength;
+    download.totalBytes = expectedLength == NSURLResponseUnknownLength ? NSURLResponseUnknownLength : download.bytesReceived + expectedLength;
+}
+
+// NSFileHandle writeData: raises an exception when the write fails (e.g. the disk is full); only iOS 13 has a variant
+// that returns an error instead.
+static BOOL writeDataToFileHandle(NSFileHandle *fileHandle, NSData *data) {
+    if (@available(iOS 13.0, *)) {
+        return [fileHandle writeData:data error:nil];
+    }
+
+    @try {
+        [fileHandle writeData:data];
+    } @catch (NSException *exception) {
+        return NO;
+    }
+    return YES;
+}
+
+// Called on the download session's delegate queue for every chunk of the response body
+- (void)resourceDownload:(ResourceDownload *)download didReceiveData:(NSData *)data {
+    if (download.fileHandle == nil) {
+        return;
+    }
+
+    if (download.isPrefetch && ![self prefetchDownload:download withinBudgetForBytes:data.length charge:YES]) {
+        return;
+    }
+
+    if (!writeDataToFileHandle(download.fileHandle, data)) {
+        NSLog(@"resourceDownload - failed to write to partial file of %@", download.url);
+        [download.fileHandle closeFile];
+        download.fileHandle = nil;
+        download.writeFailed = YES;
+        [download.dataTask cancel];
+        return;
+    }
+    download.bytesReceived += data.length;
+
+    int64_t bytesReceived = download.bytesReceived;
+    int64_t totalBytes = download.totalBytes;
+    [self onCallbackQueue:^{
+        for (DownloadProgressCallback progress in download.progressCallbacks) {
+            progress(bytesReceived, totalBytes);
+        }
+    }];
+}
+
+// Progress callbacks are only read on the callback queue so they are only ever added there too
+- (void)addProgressCallback:(DownloadProgressCallback)progress toResourceDownloadWithRequestKey:(NSString *)requestKey {
+    [self onCallbackQueue:^{
+        @synchronized (taskIdentifierToResourceDownloadDictionary) {
+            for (ResourceDownload *download in [taskIdentifierToResourceDownloadDictionary allValues]) {
+                if ([download.requestKey isEqualToString:requestKey]) {
+                    [download.progressCallbacks addObject:[progress copy]];
+                }
+            }
+        }
+    }];
+}
+
+// Returns the first byte offset of a "bytes <first>-<last>/<length>" Content-Range header or -1 if there is none
+- (long long)startOfContentRangeInResponse:(NSURLResponse *)response {
+    NSScanner *scanner = [NSScanner scannerWithString:[self valueForHeader:HTTP_HEADER_CONTENT_RANGE inResponse:response] ?: @""];
+    long long start = -1;
+    if (![scanner scanString:@"bytes" intoString:nil] || ![scanner scanLongLong:&start] || ![scanner scanString:@"-" intoString:nil]) {
+        return -1;
+    }
+    return start;
+}
+
+- (BOOL)isEncodedResponse:(NSURLResponse *)response {
+    NSString *encoding = [self valueForHeader:HTTP_HEADER_CONTENT_ENCODING inResponse:response];
+    return [encoding length] > 0 && [encoding caseInsensitiveCompare:CONTENT_ENCODING_IDENTITY] != NSOrderedSame;
+}
+
+// Header names are case-insensitive but allHeaderFields is a plain dictionary
+- (NSString *)valueForHeader:(NSString *)headerName inResponse:(NSURLResponse *)response {
+    if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return nil;
+    }
+
+    NSDictionary *headers = [(NSHTTPURLResponse *)response allHeaderFields];
+    for (NSString *header in headers) {
+        if ([header caseInsensitiveCompare:headerName] == NSOrderedSame) {
+            return headers[header];
+        }
+    }
+    return nil;
+}
+
+- (void)setResourceDownload:(ResourceDownload *)download forTask:(NSURLSessionTask *)task {
+    @synchronized (taskIdentifierToResourceDownloadDictionary) {
+        taskIdentifierToResourceDownloadDictionary[@(task.taskIdentifier)] = download;
+    }
+}
+
+#pragma mark - Prefetching
+
+- (void)setPrefetchPatchCount:(NSUInteger)count {
+    @synchronized (prefetchQueue) {
+        prefetchPatchCount = count;
+    }
+}
+
+- (void)setPrefetchMaxConcurrentDownloads:(NSUInteger)maxDownloads {
+    @synchronized (prefetchQueue) {
+        prefetchMaxConcurrentDownloads = MAX(maxDownloads, 1);
+    }
+}
+
+- (void)setPrefetchByteBudget:(NSUInteger)bytes {
+    @synchronized (prefetchQueue) {
+        prefetchByteBudget = bytes;
+    }
+}
+
+// The newest list is the one on screen so anything still waiting to be prefetched for an older list is dropped in favor
+// of it. Prefetches that are already running finish and count against the new list's budget.
+- (void)prefetchResourcesForPatches:(NSArray *)patches {
+    @synchronized (prefetchQueue) {
+        if (prefetchPatchCount == 0) {
+            return;
+        }
+
+        [prefetchQueue removeAllObjects];
+        prefetchBytesRemaining = prefetchByteBudget;
+
+        for (Patch *patch in [patches subarrayWithRange:NSMakeRange(0, MIN(prefetchPatchCount, [patches count]))]) {
+            [self enqueuePrefetchOfResourceUrl:patch.resourceUrl revision:patch.revision];
+            if ([patch hasExtraResource]) {
+                [self enqueuePrefetchOfResourceUrl:patch.extraResourceUrl revision:patch.revision];
+            }
+        }
+    }
+
+    [self startNextPrefetches];
+}
+
+- (void)cancelPrefetching {
+    @synchronized (prefetchQueue) {
+        [prefetchQueue removeAllObjects];
+
+        // The cancelled downloads finish through the usual path; their partial files are kept so a later download of
+        // the same resource resumes from there.
+        for (ResourceDownload *download in [requestKeyToPrefetchDownloadDictionary allValues]) {
+            [download.dataTask cancel];
+        }
+    }
+}
+
+// Must be called while holding the prefetchQueue lock
+- (void)enqueuePrefetchOfResourceUrl:(NSString *)resourceUrl revision:(NSInteger)revision {
+    if (resourceUrl == nil) {
+        return;
+    }
+
+    // Same URL and cache key as downloadPatchResource so a later download finds the prefetched data
+    ResourceDownload *download = [[ResourceDownload alloc] init];
+    download.url = [NSString stringWithFormat:@"%@%@", baseUrl, resourceUrl];
+    download.cacheKey = [self cacheKeyForUrl:download.url revision:revision];
+    download.requestKey = [self requestKeyForResourceWithCacheKey:download.cacheKey];
+    download.progressCallbacks = [[NSMutableArray alloc] init];
+    download.isPrefetch = YES;
+    [prefetchQueue addObject:download];
+}
+
+// Starts queued prefetches until the concurrency limit is reached. Resources that are cached by now or already being
+// downloaded by someone else are skipped.
+- (void)startNextPrefetches {
+    NSMutableArray *downloadsToStart = [[NSMutableArray alloc] init];
+
+    @synchronized (prefetchQueue) {
+        while ([prefetchQueue count] > 0 && prefetchBytesRemaining > 0 &&
+               [requestKeyToPrefetchDownloadDictionary count] + [downloadsToStart count] < prefetchMaxConcurrentDownloads) {
+            ResourceDownload *download = prefetchQueue[0];
+            [prefetchQueue removeObjectAtIndex:0];
+
+            if ([[PatchDiskCache sharedInstance] containsDataForKey:download.cacheKey] ||
+                [self joinInFlightRequest:download.requestKey waiter:^(NSURLSessionDataTask *task, id responseObject, NSError *error) {
+                    [self prefetchDownload:download didFinishWithError:error];
+                }]) {
+                continue;
+            }
+
+            requestKeyToPrefetchDownloadDictionary[download.requestKey] = download;
+            [downloadsToStart addObject:download];
+        }
+    }
+
+    for (ResourceDownload *download in downloadsToStart) {
+        NSLog(@"startNextPrefetches - prefetching %@", download.url);
+        [self startResourceDownload:download];
+    }
+}
+
+- (void)prefetchDownload:(ResourceDownload *)download didFinishWithError:(NSError *)error {
+    @synchronized (prefetchQueue) {
+        // Not ours (anymore) if it was promoted or we only joined someone else's download
+        if (requestKeyToPrefetchDownloadDictionary[download.requestKey] != download) {
+            return;
+        }
+
+        [requestKeyToPrefetchDownloadDictionary removeObjectForKey:download.requestKey];
+
+        // Prefetches are not retried. A failure most likely means the only network around is one prefetches may not
+        // use, so the rest of this list is not tried either.
+        if (error != nil) {
+            NSLog(@"prefetchDownload - error: %@", [error localizedDescription]);
+            [prefetchQueue removeAllObjects];
+        }
+    }
+
+    [self startNextPrefetches];
+}
+
+// Called on the download session's delegate queue as a prefetch's response and body arrive. The Content-Length is only
+// compared with what is left of the budget so a resource that cannot fit is cancelled before its body is downloaded;
+// body bytes are charged as they come in so a prefetch without a Content-Length is cancelled once it runs over.
+// Cancelled prefetches keep their partial file like any other download. Returns NO if the prefetch was cancelled.
+- (BOOL)prefetchDownload:(ResourceDownload *)download withinBudgetForBytes:(uint64_t)bytes charge:(BOOL)charge {
+    @synchronized (prefetchQueue) {
+        // Promoted downloads are no longer bound by the budget
+        if (requestKeyToPrefetchDownloadDictionary[download.requestKey] != download) {
+            return YES;
+        }
+
+        if (bytes > prefetchBytesRemaining) {
+            NSLog(@"prefetchDownload - %@ does not fit the remaining budget of %lu bytes", download.url, (unsigned long)prefetchBytesRemaining);
+            prefetchBytesRemaining = 0;
+            [download.dataTask cancel];
+            return NO;
+        }
+
+        if (charge) {
+            prefetchBytesRemaining -= bytes;
+        }
+        return YES;
     }
-    
-    NSString *url = [NSString stringWithFormat:@"%@%@", [[ChuckPadSocial sharedInstance] getBaseUrl], patch.extraResourceUrl];
-    [self getData:url callback:callback];
 }
 
-- (void)getData:(NSString *)url callback:(DownloadResourceCallback)callback {
-    NSLog(@"getData - url = %@", url);
+// Someone is now waiting for a download that started out as a prefetch. From here on it runs at normal priority, is
+// retried like any other download and no longer counts against the prefetch limits. The attempt in progress still
+// avoids metered networks; if it fails because of that the retry does not.
+- (void)promotePrefetchDownloadWithRequestKey:(NSString *)requestKey {
+    @synchronized (prefetchQueue) {
+        ResourceDownload *download = requestKeyToPrefetchDownloadDictionary[requestKey];
+        if (download == nil) {
+            return;
+        }
 
-    NSData *patchDataFromCache = [[PatchCache sharedInstance] objectForKey:url];
-    if (patchDataFromCache != nil) {
-        NSLog(@"getData - using cached data");
-        callback(patchDataFromCache, nil);
-        return;
+        NSLog(@"promotePrefetchDownloadWithRequestKey - %@ is no longer a prefetch", download.url);
+        [requestKeyToPrefetchDownloadDictionary removeObjectForKey:requestKey];
+        download.isPrefetch = NO;
+        download.retriesRemaining = RESOURCE_DOWNLOAD_MAX_RETRIES;
+        download.dataTask.priority = NSURLSessionTaskPriorityDefault;
     }
-    
-    // TODO Use AFNetworking if I can figure out how to make it work easily
-    [[[NSURLSession sharedSession] dataTaskWithURL:[NSURL URLWithString:url] completionHandler:^(NSData *data, NSURLResponse *response, NSError *error) {
-        int statusCode = -1;
-        if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
-            statusCode = (int)[(NSHTTPURLResponse *) response statusCode];
-        }
 
-        if (error == nil && data != nil && (statusCode == 200 || statusCode == -1)) {
-            [[PatchCache sharedInstance] setObject:data forKey:url];
-            callback(data, nil);
-        } else {
-            callback(nil, [self errorWithErrorString:ERROR_STRING_ERROR_DOWNLOADING_PATCH_RESOURCE]);
-        }
-    }] resume];
+    [self startNextPrefetches];
 }
 
 #pragma mark - Patches API - Creating/Updating/Deleting
 
+- (void)setOptimisticMutationsEnabled:(BOOL)enabled {
+    optimisticMutationsEnabled = enabled;
+}
+
+- (void)setUploadCompressionEnabled:(BOOL)enabled {
+    uploadCompressionEnabled = enabled;
+}
+
+- (void)setDeltaUploadsEnabled:(BOOL)enabled {
+    deltaUploadsEnabled = enabled;
+}
+
+- (void)setDeltaDownloadsEnabled:(BOOL)enabled {
+    deltaDownloadsEnabled = enabled;
+}
+
 - (void)updatePatch:(Patch *)patch hidden:(NSNumber *)isHidden name:(NSString *)name description:(NSString *)description
           patchData:(NSData *)patchData extraMetaData:(NSData *)extraData callback:(UpdatePatchCallback)callback {
     // If the user is not logged in, fail now because not being logged in means you cannot update a patch
     if (![self isLoggedIn]) {
         NSLog(@"updatePatch - no user is currently logged in");
-        callback(false, nil, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorBecauseNotLoggedIn]); }];
         return;
     }
     
-    // Flush cache for getting my patches
-    [[PatchCache sharedInstance] removeObjectForKey:GET_MY_PATCHES_URL];
+    // Patches are shared by every cached list (see PatchIdentityMap) so changing the patch itself is enough to update
+    // all of them. Otherwise flush cache for getting my patches.
+    NSDictionary *rollbackValues = nil;
+    if (optimisticMutationsEnabled) {
+        rollbackValues = [self applyOptimisticUpdateToPatch:patch values:@{ @"hidden" : isHidden ?: [NSNull null],
+                                                                            @"name" : name ?: [NSNull null],
+                                                                            @"patchDescription" : description ?: [NSNull null] }];
+    } else {
+        [[PatchCache sharedInstance] removeObjectsForKeyPrefix:GET_MY_PATCHES_URL];
+        [[PatchCache sharedInstance] removeObjectForKey:[self cacheKeyForPatchInfo:patch.guid]];
+    }
 
     NSURL *url = [[NSURL alloc] initWithString:[NSString stringWithFormat:@"%@%@", baseUrl, UPDATE_PATCH_URL]];
 
@@ -540,32 +1559,101 @@ static dispatch_once_t onceToken;
     [self appendIfNotNilToRequestParams:requestParams key:PATCH_NAME_PARAM_NAME value:name];
     [self appendIfNotNilToRequestParams:requestParams key:PATCH_DESCRIPTION_PARAM_NAME value:description];
     [self appendIfNotNilToRequestParams:requestParams key:PATCH_IS_HIDDEN_PARAM_NAME value:isHidden];
-    
-    [self POST:url.absoluteString parameters:requestParams constructingBodyWithBlock:^(id <AFMultipartFormData> formData) {
-        [self appendFormData:formData patchData:patchData extraData:extraData];
-    } progress:nil success:^(NSURLSessionDataTask *task, id responseObject) {
-        NSLog(@"updatePatch - success: %@", responseObject);
-        if ([self responseOk:responseObject]) {
-            callback(true, [self getPatchFromMessageResponse:responseObject], nil);
-        } else {
-            callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+
+    // Hashing the data and diffing it against the cached revision can take a while for large patches, so it is done on
+    // the processing queue rather than on the calling thread
+    dispatch_async(processingQueue, ^{
+        // Data parts whose bytes are identical to what the service already stores for this revision are left out,
+        // which the service treats the same as passing nil. A name-only edit then uploads no data at all.
+        PatchContentHashes *contentHashes = [PatchContentHashes sharedInstance];
+        NSString *knownPatchDataHash = [contentHashes hashForPart:PATCH_DATA_PARAM_NAME ofPatchWithGUID:patch.guid revision:patch.revision];
+        NSString *knownExtraDataHash = [contentHashes hashForPart:PATCH_EXTRA_DATA_PARAM_NAME ofPatchWithGUID:patch.guid revision:patch.revision];
+        NSString *patchDataHash = patchData != nil ? [PatchContentHashes SHA256HexDigestForData:patchData] : knownPatchDataHash;
+        NSString *extraDataHash = extraData != nil ? [PatchContentHashes SHA256HexDigestForData:extraData] : knownExtraDataHash;
+
+        NSData *patchDataToSend = [patchDataHash isEqualToString:knownPatchDataHash] ? nil : patchData;
+        NSData *extraDataToSend = [extraDataHash isEqualToString:knownExtraDataHash] ? nil : extraData;
+        if (patchDataToSend != patchData || extraDataToSend != extraData) {
+            NSLog(@"updatePatch - leaving out unchanged data (patch data: %d, extra data: %d)", patchDataToSend != patchData, extraDataToSend != extraData);
         }
-    } failure:^(NSURLSessionDataTask *task, NSError *error) {
-        NSLog(@"updatePatch - error: %@", [error localizedDescription]);
-        callback(false, nil, [self errorMakingNetworkCall:error]);
-    }];
+
+        // Our hashes are only as fresh as the revision on patch, which may be stale if the patch was edited elsewhere
+        // since. Sending the hash of each part left out lets the service reject the update if its copy no longer matches.
+        if (patchDataToSend != patchData) {
+            requestParams[PATCH_DATA_UNCHANGED_SHA256_PARAM_NAME] = knownPatchDataHash;
+        }
+        if (extraDataToSend != extraData) {
+            requestParams[PATCH_EXTRA_DATA_UNCHANGED_SHA256_PARAM_NAME] = knownExtraDataHash;
+        }
+
+        // In delta mode a changed data part is sent as a binary diff against our cached copy of the current revision,
+        // together with that revision number and the SHA-256 of the full data so the service can verify what it
+        // rebuilds. Only parts that are being sent get a delta so this never touches the unchanged hashes above.
+        NSData *patchDataDelta = deltaUploadsEnabled ? [self deltaForPart:PATCH_DATA_PARAM_NAME ofPatch:patch data:patchDataToSend] : nil;
+        NSData *extraDataDelta = deltaUploadsEnabled ? [self deltaForPart:PATCH_EXTRA_DATA_PARAM_NAME ofPatch:patch data:extraDataToSend] : nil;
+        if (patchDataDelta != nil || extraDataDelta != nil) {
+            requestParams[PATCH_DELTA_BASE_REVISION_PARAM_NAME] = @(patch.revision);
+        }
+        if (patchDataDelta != nil) {
+            requestParams[PATCH_DATA_SHA256_PARAM_NAME] = patchDataHash;
+            patchDataToSend = nil;
+        }
+        if (extraDataDelta != nil) {
+            requestParams[PATCH_EXTRA_DATA_SHA256_PARAM_NAME] = extraDataHash;
+            extraDataToSend = nil;
+        }
+    
+        [self POST:url.absoluteString parameters:requestParams constructingBodyWithBlock:^(id <AFMultipartFormData> formData) {
+            [self appendFormData:formData patchData:patchDataToSend extraData:extraDataToSend];
+            if (patchDataDelta != nil) {
+                [self appendFilePartToFormData:formData data:patchDataDelta name:PATCH_DATA_DELTA_PARAM_NAME fileName:@"data.delta"];
+            }
+            if (extraDataDelta != nil) {
+                [self appendFilePartToFormData:formData data:extraDataDelta name:PATCH_EXTRA_DATA_DELTA_PARAM_NAME fileName:@"extra_data.delta"];
+            }
+        } progress:nil success:^(NSURLSessionDataTask *task, id responseObject) {
+            NSLog(@"updatePatch - success: %@", responseObject);
+            if ([self responseOk:responseObject]) {
+                Patch *updatedPatch = [self getPatchFromMessageResponse:responseObject];
+
+                // Keep the new revision's data around as the base for the next delta
+                if (deltaUploadsEnabled) {
+                    [self cacheResourceData:patchData forPart:PATCH_DATA_PARAM_NAME ofPatch:updatedPatch];
+                    [self cacheResourceData:extraData forPart:PATCH_EXTRA_DATA_PARAM_NAME ofPatch:updatedPatch];
+                }
+
+                [contentHashes setHash:patchDataHash forPart:PATCH_DATA_PARAM_NAME ofPatchWithGUID:updatedPatch.guid revision:updatedPatch.revision];
+                [contentHashes setHash:extraDataHash forPart:PATCH_EXTRA_DATA_PARAM_NAME ofPatchWithGUID:updatedPatch.guid revision:updatedPatch.revision];
+                [self onCallbackQueue:^{ callback(true, updatedPatch, nil); }];
+            } else {
+                [self rollbackOptimisticUpdateToPatch:patch values:rollbackValues];
+                [self onCallbackQueue:^{ callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
+            }
+        } failure:^(NSURLSessionDataTask *task, NSError *error) {
+            NSLog(@"updatePatch - error: %@", [error localizedDescription]);
+            [self rollbackOptimisticUpdateToPatch:patch values:rollbackValues];
+            [self onCallbackQueue:^{ callback(false, nil, [self errorMakingNetworkCall:error]); }];
+        }];
+    });
 }
 
 - (void)updatePatch:(Patch *)patch latitude:(NSNumber *)lat longitude:(NSNumber *)lng callback:(UpdatePatchCallback)callback {
     // If the user is not logged in, fail now because not being logged in means you cannot update a patch
     if (![self isLoggedIn]) {
         NSLog(@"updatePatch - no user is currently logged in");
-        callback(false, nil, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorBecauseNotLoggedIn]); }];
         return;
     }
     
-    // Flush cache for getting my patches
-    [[PatchCache sharedInstance] removeObjectForKey:GET_MY_PATCHES_URL];
+    NSDictionary *rollbackValues = nil;
+    if (optimisticMutationsEnabled) {
+        rollbackValues = [self applyOptimisticUpdateToPatch:patch values:@{ @"latitude" : lat ?: [NSNull null],
+                                                                            @"longitude" : lng ?: [NSNull null] }];
+    } else {
+        // Flush cache for getting my patches
+        [[PatchCache sharedInstance] removeObjectsForKeyPrefix:GET_MY_PATCHES_URL];
+        [[PatchCache sharedInstance] removeObjectForKey:[self cacheKeyForPatchInfo:patch.guid]];
+    }
     
     NSURL *url = [[NSURL alloc] initWithString:[NSString stringWithFormat:@"%@%@", baseUrl, UPDATE_PATCH_URL]];
     
@@ -585,16 +1673,102 @@ static dispatch_once_t onceToken;
        success:^(NSURLSessionDataTask *task, id responseObject) {
            NSLog(@"updatePatch - success: %@", responseObject);
            if ([self responseOk:responseObject]) {
-               callback(true, [self getPatchFromMessageResponse:responseObject], nil);
+               Patch *updatedPatch = [self getPatchFromMessageResponse:responseObject];
+               [self onCallbackQueue:^{ callback(true, updatedPatch, nil); }];
            } else {
-               callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+               [self rollbackOptimisticUpdateToPatch:patch values:rollbackValues];
+               [self onCallbackQueue:^{ callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
            }
        } failure:^(NSURLSessionDataTask *task, NSError *error) {
            NSLog(@"updatePatch - error: %@", [error localizedDescription]);
-           callback(false, nil, [self errorMakingNetworkCall:error]);
+           [self rollbackOptimisticUpdateToPatch:patch values:rollbackValues];
+           [self onCallbackQueue:^{ callback(false, nil, [self errorMakingNetworkCall:error]); }];
        }];
 }
 
+// Sets the properties in values on patch and returns, for rollback, the previous and the applied value of each property
+// changed. NSNull stands for a nil parameter: that property is left alone, except for location where nil clears it.
+- (NSDictionary *)applyOptimisticUpdateToPatch:(Patch *)patch values:(NSDictionary *)values {
+    BOOL isLocationUpdate = values[@"latitude"] != nil;
+
+    NSMutableDictionary *rollbackValues = [[NSMutableDictionary alloc] init];
+    for (NSString *property in values) {
+        id value = values[property];
+        if (value == [NSNull null] && !isLocationUpdate) {
+            continue;
+        }
+
+        rollbackValues[property] = @[ [patch valueForKey:property] ?: [NSNull null], value ];
+        [patch setValue:(value == [NSNull null] ? nil : value) forKey:property];
+    }
+
+    NSLog(@"applyOptimisticUpdateToPatch - applied %@ to %@", [[rollbackValues allKeys] componentsJoinedByString:@", "], patch.guid);
+    return rollbackValues;
+}
+
+- (void)rollbackOptimisticUpdateToPatch:(Patch *)patch values:(NSDictionary *)rollbackValues {
+    if (rollbackValues == nil) {
+        return;
+    }
+
+    // A property that no longer holds what we applied was changed since, e.g. by a refreshed list mapping newer values
+    // onto the shared Patch (see PatchIdentityMap). It is left alone and the cached copies are dropped instead.
+    NSLog(@"rollbackOptimisticUpdateToPatch - rolling back %@", patch.guid);
+    BOOL changedSince = NO;
+    for (NSString *property in rollbackValues) {
+        id previousValue = rollbackValues[property][0];
+        id appliedValue = rollbackValues[property][1];
+        if (![([patch valueForKey:property] ?: [NSNull null]) isEqual:appliedValue]) {
+            changedSince = YES;
+            continue;
+        }
+        [patch setValue:(previousValue == [NSNull null] ? nil : previousValue) forKey:property];
+    }
+
+    if (changedSince) {
+        [[PatchCache sharedInstance] removeObjectsForKeyPrefix:GET_MY_PATCHES_URL];
+        [[PatchCache sharedInstance] removeObjectForKey:[self cacheKeyForPatchInfo:patch.guid]];
+    }
+}
+
+// Returns a delta turning our cached copy of the patch's current revision of part into data, or nil if we have no
+// cached copy or the delta would not be much smaller than data itself.
+- (NSData *)deltaForPart:(NSString *)part ofPatch:(Patch *)patch data:(NSData *)data {
+    NSString *cacheKey = [self resourceCacheKeyForPart:part ofPatch:patch];
+    if (data == nil || cacheKey == nil) {
+        return nil;
+    }
+
+    NSData *baseData = [[PatchCache sharedInstance] dataForKey:cacheKey];
+    if (baseData == nil) {
+        return nil;
+    }
+
+    NSData *delta = [PatchDelta deltaFromData:baseData toData:data];
+    if ([delta length] > [data length] / 2) {
+        return nil;
+    }
+
+    NSLog(@"deltaForPart - sending %@ as a %lu byte delta instead of %lu bytes", part, (unsigned long)[delta length], (unsigned long)[data length]);
+    return delta;
+}
+
+- (void)cacheResourceData:(NSData *)data forPart:(NSString *)part ofPatch:(Patch *)patch {
+    NSString *cacheKey = [self resourceCacheKeyForPart:part ofPatch:patch];
+    if (data != nil && cacheKey != nil) {
+        [[PatchCache sharedInstance] setData:data forKey:cacheKey];
+    }
+}
+
+// Same key downloadPatchResource and downloadPatchExtraData cache the part's data under
+- (NSString *)resourceCacheKeyForPart:(NSString *)part ofPatch:(Patch *)patch {
+    NSString *resourceUrl = [part isEqualToString:PATCH_EXTRA_DATA_PARAM_NAME] ? patch.extraResourceUrl : patch.resourceUrl;
+    if ([resourceUrl length] == 0) {
+        return nil;
+    }
+    return [self cacheKeyForUrl:[NSString stringWithFormat:@"%@%@", baseUrl, resourceUrl] revision:patch.revision];
+}
+
 - (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID
           patchData:(NSData *)patchData extraMetaData:(NSData *)extraData callback:(CreatePatchCallback)callback {
     [self uploadPatch:patchName description:description parent:parentGUID hidden:nil latitude:nil longitude:nil
@@ -616,10 +1790,82 @@ static dispatch_once_t onceToken;
 - (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID
         hidden:(NSNumber *)isHidden latitude:(NSNumber *)lat longitude:(NSNumber *)lng patchData:(NSData *)patchData
         extraMetaData:(NSData *)extraData callback:(CreatePatchCallback)callback {
+    [self uploadPatch:patchName description:description parent:parentGUID hidden:isHidden latitude:lat longitude:lng
+          formData:^(id <AFMultipartFormData> formData) {
+              [self appendFormData:formData patchData:patchData extraData:extraData];
+          } uploaded:^(Patch *patch) {
+              PatchContentHashes *contentHashes = [PatchContentHashes sharedInstance];
+              [contentHashes setHash:(patchData != nil ? [PatchContentHashes SHA256HexDigestForData:patchData] : nil)
+                             forPart:PATCH_DATA_PARAM_NAME ofPatchWithGUID:patch.guid revision:patch.revision];
+              [contentHashes setHash:(extraData != nil ? [PatchContentHashes SHA256HexDigestForData:extraData] : nil)
+                             forPart:PATCH_EXTRA_DATA_PARAM_NAME ofPatchWithGUID:patch.guid revision:patch.revision];
+          } callback:callback];
+}
+
+// appendPartWithFileURL only accepts local regular files and reads them while the request is sent
+static BOOL isReadableRegularFile(NSURL *fileURL) {
+    if (![fileURL isFileURL]) {
+        return NO;
+    }
+
+    NSNumber *isRegularFile = nil;
+    if (![fileURL getResourceValue:&isRegularFile forKey:NSURLIsRegularFileKey error:nil] || ![isRegularFile boolValue]) {
+        return NO;
+    }
+
+    return [[NSFileManager defaultManager] isReadableFileAtPath:[fileURL path]];
+}
+
+- (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID hidden:(NSNumber *)isHidden
+       patchFileURL:(NSURL *)patchFileURL extraMetaDataFileURL:(NSURL *)extraFileURL callback:(CreatePatchCallback)callback {
+    // AFNetworking cannot fail the request from inside the form data block so check the files can be read up front
+    for (NSURL *fileURL in @[patchFileURL ?: [NSNull null], extraFileURL ?: [NSNull null]]) {
+        if ([fileURL isKindOfClass:[NSURL class]] && !isReadableRegularFile(fileURL)) {
+            NSLog(@"uploadPatch - cannot read %@", fileURL);
+            [self onCallbackQueue:^{ callback(false, nil, [self errorWithErrorString:ERROR_STRING_UPLOAD_FILE_NOT_READABLE]); }];
+            return;
+        }
+    }
+
+    [self uploadPatch:patchName description:description parent:parentGUID hidden:isHidden latitude:nil longitude:nil
+          formData:^(id <AFMultipartFormData> formData) {
+              if (patchFileURL != nil) {
+                  [formData appendPartWithFileURL:patchFileURL name:PATCH_DATA_PARAM_NAME fileName:@"data" mimeType:FILE_DATA_MIME_TYPE error:nil];
+              }
+              if (extraFileURL != nil) {
+                  [formData appendPartWithFileURL:extraFileURL name:PATCH_EXTRA_DATA_PARAM_NAME fileName:@"extra_data" mimeType:FILE_DATA_MIME_TYPE error:nil];
+              }
+          } uploaded:nil callback:callback];
+}
+
+- (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID hidden:(NSNumber *)isHidden
+        patchStream:(NSInputStream *)patchStream length:(int64_t)patchLength
+extraMetaDataStream:(NSInputStream *)extraStream length:(int64_t)extraLength callback:(CreatePatchCallback)callback {
+    [self uploadPatch:patchName description:description parent:parentGUID hidden:isHidden latitude:nil longitude:nil
+          formData:^(id <AFMultipartFormData> formData) {
+              if (patchStream != nil) {
+                  [formData appendPartWithInputStream:patchStream name:PATCH_DATA_PARAM_NAME fileName:@"data"
+                                               length:patchLength mimeType:FILE_DATA_MIME_TYPE];
+              }
+              if (extraStream != nil) {
+                  [formData appendPartWithInputStream:extraStream name:PATCH_EXTRA_DATA_PARAM_NAME fileName:@"extra_data"
+                                               length:extraLength mimeType:FILE_DATA_MIME_TYPE];
+              }
+          } uploaded:nil callback:callback];
+}
+
+// All uploadPatch variants end up here; they only differ in where the bodies of the data parts come from. AFNetworking
+// sends multipart requests from a body stream that pulls from each part's source as the upload proceeds, so parts
+// backed by a file or input stream are never loaded into memory as a whole. If given, uploaded is called on the
+// processing queue with the created patch before the callback.
+- (void)uploadPatch:(NSString *)patchName description:(NSString *)description parent:(NSString *)parentGUID
+        hidden:(NSNumber *)isHidden latitude:(NSNumber *)lat longitude:(NSNumber *)lng
+        formData:(void (^)(id <AFMultipartFormData> formData))appendParts uploaded:(void (^)(Patch *patch))uploaded
+        callback:(CreatePatchCallback)callback {
     // If the user is not logged in, fail now because not being logged in means you cannot update a patch
     if (![self isLoggedIn]) {
         NSLog(@"uploadPatch - no user is currently logged in");
-        callback(false, nil, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorBecauseNotLoggedIn]); }];
         return;
     }
 
@@ -642,20 +1888,22 @@ static dispatch_once_t onceToken;
     }
 
     // Flush cache for getting my patches
-    [[PatchCache sharedInstance] removeObjectForKey:GET_MY_PATCHES_URL];
+    [[PatchCache sharedInstance] removeObjectsForKeyPrefix:GET_MY_PATCHES_URL];
 
-    [self POST:url.absoluteString parameters:requestParams constructingBodyWithBlock:^(id <AFMultipartFormData> formData) {
-        [self appendFormData:formData patchData:patchData extraData:extraData];
-    } progress:nil success:^(NSURLSessionDataTask *task, id responseObject) {
+    [self POST:url.absoluteString parameters:requestParams constructingBodyWithBlock:appendParts progress:nil success:^(NSURLSessionDataTask *task, id responseObject) {
         NSLog(@"uploadPatch - success: %@", responseObject);
         if ([self responseOk:responseObject]) {
-            callback(true, [self getPatchFromMessageResponse:responseObject], nil);
+            Patch *patch = [self getPatchFromMessageResponse:responseObject];
+            if (uploaded != nil) {
+                uploaded(patch);
+            }
+            [self onCallbackQueue:^{ callback(true, patch, nil); }];
         } else {
-            callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+            [self onCallbackQueue:^{ callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
         }
     } failure:^(NSURLSessionDataTask *task, NSError *error) {
         NSLog(@"uploadPatch - error: %@", [error localizedDescription]);
-        callback(false, nil, [self errorMakingNetworkCall:error]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorMakingNetworkCall:error]); }];
     }];
 }
 
@@ -663,7 +1911,7 @@ static dispatch_once_t onceToken;
     // If the user is not logged in, fail now because not being logged in means you cannot delete a patch
     if (![self isLoggedIn]) {
         NSLog(@"deletePatch - no user is currently logged in");
-        callback(false, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, [self errorBecauseNotLoggedIn]); }];
         return;
     }
     
@@ -671,38 +1919,90 @@ static dispatch_once_t onceToken;
     
     NSLog(@"deletePatch - url = %@", url.absoluteString);
  
-    // Flush cache for getting my patches and the resource since we're about to delete one
-    [[PatchCache sharedInstance] removeObjectForKey:GET_MY_PATCHES_URL];
-    [[PatchCache sharedInstance] removeObjectForKey:[NSString stringWithFormat:@"%@%@", [[ChuckPadSocial sharedInstance] getBaseUrl], patch.resourceUrl]];
+    // Either take the patch out of every cached list right away or flush cache for getting my patches and every other
+    // list the patch is in. Drop the resource either way since we're about to delete it.
+    NSDictionary *rollbackLists = nil;
+    if (optimisticMutationsEnabled) {
+        rollbackLists = [self applyOptimisticDeleteOfPatch:patch];
+    } else {
+        [[PatchCache sharedInstance] removeObjectsForKeyPrefix:GET_MY_PATCHES_URL];
+        [[PatchCache sharedInstance] removeObjectsContainingPatchGUID:patch.guid];
+    }
+    [[PatchCache sharedInstance] removeObjectForKey:[self cacheKeyForPatchInfo:patch.guid]];
+    NSString *resourceUrl = [NSString stringWithFormat:@"%@%@", [[ChuckPadSocial sharedInstance] getBaseUrl], patch.resourceUrl];
+    [[PatchCache sharedInstance] removeDataForKey:[self cacheKeyForUrl:resourceUrl revision:patch.revision]];
     
     [self GET:url.absoluteString parameters:[self getCurrentUserAuthParamsDictionary] progress:nil
       success:^(NSURLSessionTask *task, id responseObject) {
           NSLog(@"deletePatch - success: %@", responseObject);
           if ([self responseOk:responseObject]) {
-              callback(YES, nil);
+              [[PatchIdentityMap sharedInstance] removePatchForGUID:patch.guid];
+              [[PatchContentHashes sharedInstance] removeHashesForPatchWithGUID:patch.guid];
+              [self onCallbackQueue:^{ callback(YES, nil); }];
           } else {
-              callback(NO, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+              [self rollbackOptimisticDeleteWithLists:rollbackLists];
+              [self onCallbackQueue:^{ callback(NO, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
           }
       }
       failure:^(NSURLSessionTask *operation, NSError *error) {
           NSLog(@"deletePatch - error: %@", [error localizedDescription]);
-          callback(NO, [self errorMakingNetworkCall:error]);
+          [self rollbackOptimisticDeleteWithLists:rollbackLists];
+          [self onCallbackQueue:^{ callback(NO, [self errorMakingNetworkCall:error]); }];
       }];
 }
 
+// Replaces every cached list containing patch with a copy without it and returns, for rollback, the original and the
+// replacement of each list. Paged lists are dropped instead since a page that suddenly comes up short would look like
+// the end of the list.
+- (NSDictionary *)applyOptimisticDeleteOfPatch:(Patch *)patch {
+    NSDictionary *keyToListDictionary = [[PatchCache sharedInstance] objectsContainingPatchGUID:patch.guid];
+    NSString *pageKeyMarker = [NSString stringWithFormat:@"?%@=", PAGE_LIMIT_PARAM_NAME];
+
+    NSMutableDictionary *rollbackLists = [[NSMutableDictionary alloc] init];
+    for (NSString *key in keyToListDictionary) {
+        if ([key rangeOfString:pageKeyMarker].location != NSNotFound) {
+            [[PatchCache sharedInstance] removeObjectForKey:key];
+            continue;
+        }
+
+        NSArray *list = keyToListDictionary[key];
+        NSIndexSet *indexesToKeep = [list indexesOfObjectsPassingTest:^BOOL(Patch *listPatch, NSUInteger idx, BOOL *stop) {
+            return ![listPatch.guid isEqualToString:patch.guid];
+        }];
+        NSArray *listWithoutPatch = [list objectsAtIndexes:indexesToKeep];
+        [[PatchCache sharedInstance] replaceObject:listWithoutPatch forKey:key];
+        rollbackLists[key] = @[ list, listWithoutPatch ];
+    }
+
+    NSLog(@"applyOptimisticDeleteOfPatch - removed %@ from %lu cached lists", patch.guid, (unsigned long)[keyToListDictionary count]);
+    return rollbackLists;
+}
+
+// Only lists that still are the ones we put in are restored. Anything else was refreshed or replaced since and is
+// dropped rather than overwritten with our older snapshot.
+- (void)rollbackOptimisticDeleteWithLists:(NSDictionary *)rollbackLists {
+    for (NSString *key in rollbackLists) {
+        NSArray *list = rollbackLists[key][0];
+        NSArray *listWithoutPatch = rollbackLists[key][1];
+        if (![[PatchCache sharedInstance] replaceObject:listWithoutPatch withObject:list forKey:key]) {
+            [[PatchCache sharedInstance] removeObjectForKey:key];
+        }
+    }
+}
+
 #pragma mark - Patch Reporting API
 
 - (void)reportAbuse:(Patch *)patch isAbuse:(BOOL)isAbuse callback:(ReportAbuseCallback)callback {
     // If the user is not logged in, fail now because not being logged in means you cannot report an abusive patch
     if (![self isLoggedIn]) {
         NSLog(@"reportAbuse - no user is currently logged in");
-        callback(false, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, [self errorBecauseNotLoggedIn]); }];
         return;
     }
     
     if (patch.creatorId == [self getLoggedInUserId]) {
         NSLog(@"reportAbuse - user attempting to report their own patch as abusive");
-        callback(false, [self errorWithErrorString:ERROR_STRING_REPORTING_OWN_PATCH]);
+        [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:ERROR_STRING_REPORTING_OWN_PATCH]); }];
         return;
     }
     
@@ -717,14 +2017,14 @@ static dispatch_once_t onceToken;
        success:^(NSURLSessionTask *task, id responseObject) {
            NSLog(@"reportAbuse - success: %@", responseObject);
            if ([self responseOk:responseObject]) {
-               callback(YES, nil);
+               [self onCallbackQueue:^{ callback(YES, nil); }];
            } else {
-               callback(NO, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+               [self onCallbackQueue:^{ callback(NO, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
            }
        }
        failure:^(NSURLSessionTask *operation, NSError *error) {
            NSLog(@"reportAbuse - error: %@", [error localizedDescription]);
-           callback(NO, [self errorMakingNetworkCall:error]);
+           [self onCallbackQueue:^{ callback(NO, [self errorMakingNetworkCall:error]); }];
        }];
 }
 
@@ -735,25 +2035,162 @@ static dispatch_once_t onceToken;
 
     NSMutableDictionary *requestParams = [self getCurrentUserAuthParamsDictionary];
     [requestParams setObject:patch.guid forKey:PATCH_GUID_PARAM_NAME];
+
+    NSString *requestKey = [self inFlightRequestKeyForMethod:@"GET" url:url.absoluteString parameters:requestParams extra:nil];
+    if ([self joinInFlightRequest:requestKey waiter:^(NSURLSessionDataTask *task, id patchVersions, NSError *error) {
+        [self onCallbackQueue:^{ callback(error == nil, patchVersions, error); }];
+    }]) {
+        NSLog(@"getPatchVersions - joined in-flight request");
+        return;
+    }
     
     [self GET:url.absoluteString parameters:requestParams progress:nil
-      success:^(NSURLSessionTask *task, id responseObject) {
+      success:^(NSURLSessionDataTask *task, id responseObject) {
           NSLog(@"getPatchVersions - success: %@", responseObject);
           if ([self responseOk:responseObject]) {
-              callback(YES, [self getPatchVersionsArray:responseObject], nil);
+              [self completeInFlightRequest:requestKey task:task responseObject:[self getPatchVersionsArray:responseObject] error:nil];
           } else {
-              callback(NO, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+              [self completeInFlightRequest:requestKey task:task responseObject:nil
+                                      error:[self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]];
           }
       }
-      failure:^(NSURLSessionTask *operation, NSError *error) {
+      failure:^(NSURLSessionDataTask *task, NSError *error) {
           NSLog(@"getPatchVersions - error: %@", [error localizedDescription]);
-          callback(NO, nil, [self errorMakingNetworkCall:error]);
+          [self completeInFlightRequest:requestKey task:task responseObject:nil error:[self errorMakingNetworkCall:error]];
       }];
 }
 
 - (void)downloadPatchVersion:(Patch *)patch version:(NSInteger)version callback:(DownloadResourceCallback)callback {
-    NSString *url = [NSString stringWithFormat:@"%@%@%@/%ld", baseUrl, PATCH_VERSIONS_DOWNLOAD_URL, patch.guid, (long)version];
-    [self getData:url callback:callback];
+    [self downloadPatchVersion:patch version:version progress:nil callback:callback];
+}
+
+- (void)downloadPatchVersion:(Patch *)patch version:(NSInteger)version progress:(DownloadProgressCallback)progress
+                    callback:(DownloadResourceCallback)callback {
+    NSString *url = [self urlForVersion:version ofPatchWithGUID:patch.guid];
+    if (!deltaDownloadsEnabled) {
+        [self getData:url cacheKey:url progress:progress callback:callback];
+        return;
+    }
+
+    // Looking for a cached version waits on the disk cache's queue, which may be busy writing a blob
+    dispatch_async(processingQueue, ^{
+        [self downloadPatchVersion:patch version:version url:url progress:progress callback:callback];
+    });
+}
+
+- (void)downloadPatchVersion:(Patch *)patch version:(NSInteger)version url:(NSString *)url progress:(DownloadProgressCallback)progress
+                    callback:(DownloadResourceCallback)callback {
+    NSInteger baseVersion = [self cachedVersionNearestToVersion:version ofPatchWithGUID:patch.guid];
+    if (baseVersion == NSNotFound) {
+        [self getData:url cacheKey:url progress:progress callback:callback];
+        return;
+    }
+
+    NSLog(@"downloadPatchVersion - requesting version %ld as a delta against version %ld", (long)version, (long)baseVersion);
+
+    // Coalesces with full downloads of the same version since both end up storing the same bytes under url
+    NSString *requestKey = [self requestKeyForResourceWithCacheKey:url];
+    if ([self joinResourceDownload:requestKey progress:progress callback:callback]) {
+        NSLog(@"downloadPatchVersion - joined in-flight download");
+        return;
+    }
+
+    NSString *baseUrlForDelta = [self urlForVersion:baseVersion ofPatchWithGUID:patch.guid];
+    NSError *serializationError = nil;
+    NSMutableURLRequest *request = [downloadRequestSerializer requestWithMethod:@"GET" URLString:url
+                                                                     parameters:@{PATCH_DELTA_BASE_VERSION_PARAM_NAME : @(baseVersion)}
+                                                                          error:&serializationError];
+    if (serializationError != nil) {
+        [self startResourceDownloadForUrl:url cacheKey:url requestKey:requestKey progress:progress];
+        return;
+    }
+    [request setValue:ACCEPT_ENCODING_COMPRESSED forHTTPHeaderField:HTTP_HEADER_ACCEPT_ENCODING];
+
+    // Deltas are small so unlike startResourceDownload this is a plain in-memory request without progress or resuming.
+    // Anything that goes wrong, including a result that fails verification, falls back to downloading the full version.
+    NSMutableData *responseData = [[NSMutableData alloc] init];
+    DataTaskHandler *handler = [[DataTaskHandler alloc] init];
+    handler.dataHandler = ^(NSData *data) {
+        [responseData appendData:data];
+    };
+    handler.completionHandler = ^(NSURLResponse *response, NSError *error) {
+        NSData *versionData = nil;
+        if (error == nil) {
+            versionData = [self versionDataFromDeltaResponse:response data:responseData baseVersion:baseVersion baseCacheKey:baseUrlForDelta];
+        }
+
+        if (versionData == nil) {
+            NSLog(@"downloadPatchVersion - delta download failed, downloading version %ld in full", (long)version);
+            [self startResourceDownloadForUrl:url cacheKey:url requestKey:requestKey progress:progress];
+            return;
+        }
+
+        [[PatchCache sharedInstance] setData:versionData forKey:url];
+        [self completeInFlightRequest:requestKey task:nil responseObject:versionData error:nil];
+    };
+
+    [[self dataTaskWithSession:downloadSession request:request handler:handler] resume];
+}
+
+// Versions are immutable so their URL doubles as their cache key
+- (NSString *)urlForVersion:(NSInteger)version ofPatchWithGUID:(NSString *)guid {
+    return [NSString stringWithFormat:@"%@%@%@/%ld", baseUrl, PATCH_VERSIONS_DOWNLOAD_URL, guid, (long)version];
+}
+
+// Returns NSNotFound if version itself is cached (getData will answer from the cache) or no other version of the patch
+// is. Otherwise returns the cached version closest to version, preferring the older one on a tie since history is
+// usually browsed backwards from the latest version.
+- (NSInteger)cachedVersionNearestToVersion:(NSInteger)version ofPatchWithGUID:(NSString *)guid {
+    NSString *prefix = [NSString stringWithFormat:@"%@%@%@/", baseUrl, PATCH_VERSIONS_DOWNLOAD_URL, guid];
+    NSInteger nearestVersion = NSNotFound;
+    NSInteger nearestDistance = NSIntegerMax;
+
+    for (NSString *key in [[PatchDiskCache sharedInstance] keysWithPrefix:prefix]) {
+        NSString *versionString = [key substringFromIndex:[prefix length]];
+        NSInteger cachedVersion = [versionString integerValue];
+        if (![versionString isEqualToString:[NSString stringWithFormat:@"%ld", (long)cachedVersion]]) {
+            continue;
+        }
+        if (cachedVersion == version) {
+            return NSNotFound;
+        }
+
+        NSInteger distance = labs(cachedVersion - version);
+        if (distance < nearestDistance || (distance == nearestDistance && cachedVersion < nearestVersion)) {
+            nearestVersion = cachedVersion;
+            nearestDistance = distance;
+        }
+    }
+
+    return nearestVersion;
+}
+
+// The service answers a delta request with a delta marked with the version it was made against or, if it has none to
+// offer, with the full version. Returns the data of the requested version or nil if it cannot be trusted: the result
+// must match the SHA-256 the service sent, and a delta without one is rejected outright since nothing else would catch
+// it being applied to the wrong base.
+- (NSData *)versionDataFromDeltaResponse:(NSURLResponse *)response data:(NSData *)data baseVersion:(NSInteger)baseVersion
+                            baseCacheKey:(NSString *)baseCacheKey {
+    NSString *deltaBaseVersion = [self valueForHeader:HTTP_HEADER_DELTA_BASE_VERSION inResponse:response];
+    NSString *expectedHash = [self valueForHeader:HTTP_HEADER_CONTENT_SHA256 inResponse:response];
+
+    NSData *versionData = data;
+    if (deltaBaseVersion != nil) {
+        NSData *baseData = [[PatchCache sharedInstance] dataForKey:baseCacheKey];
+        if (expectedHash == nil || baseData == nil || [deltaBaseVersion integerValue] != baseVersion) {
+            return nil;
+        }
+        versionData = [PatchDelta dataByApplyingDelta:data toData:baseData];
+    }
+
+    if (versionData == nil) {
+        return nil;
+    }
+    if (expectedHash != nil && [[PatchContentHashes SHA256HexDigestForData:versionData] caseInsensitiveCompare:expectedHash] != NSOrderedSame) {
+        NSLog(@"downloadPatchVersion - version data does not match its hash");
+        return nil;
+    }
+    return versionData;
 }
 
 #pragma mark - Live API
@@ -762,7 +2199,7 @@ static dispatch_once_t onceToken;
     // If the user is not logged in, fail now because a live session must have a user who owns it.
     if (![self isLoggedIn]) {
         NSLog(@"createLiveSession - no user is currently logged in");
-        callback(false, nil, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorBecauseNotLoggedIn]); }];
         return;
     }
     
@@ -781,13 +2218,14 @@ constructingBodyWithBlock:
     } progress:nil success:^(NSURLSessionDataTask *task, id responseObject) {
         NSLog(@"createLiveSession - success: %@", responseObject);
         if ([self responseOk:responseObject]) {
-            callback(true, [self getLiveSessionFromMessageResponse:responseObject], nil);
+            LiveSession *liveSession = [self getLiveSessionFromMessageResponse:responseObject];
+            [self onCallbackQueue:^{ callback(true, liveSession, nil); }];
         } else {
-            callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+            [self onCallbackQueue:^{ callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
         }
     } failure:^(NSURLSessionDataTask *task, NSError *error) {
         NSLog(@"createLiveSession - error: %@", [error localizedDescription]);
-        callback(false, nil, [self errorMakingNetworkCall:error]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorMakingNetworkCall:error]); }];
     }];
 }
 
@@ -795,7 +2233,7 @@ constructingBodyWithBlock:
     // If the user is not logged in, fail now because only the authenticated creator can close a live session.
     if (![self isLoggedIn]) {
         NSLog(@"closeLiveSession - no user is currently logged in");
-        callback(false, nil, [self errorBecauseNotLoggedIn]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorBecauseNotLoggedIn]); }];
         return;
     }
     
@@ -807,13 +2245,14 @@ constructingBodyWithBlock:
     [self POST:url.absoluteString parameters:requestParams constructingBodyWithBlock:nil progress:nil success:^(NSURLSessionDataTask *task, id responseObject) {
         NSLog(@"closeLiveSession - success: %@", responseObject);
         if ([self responseOk:responseObject]) {
-            callback(true, [self getLiveSessionFromMessageResponse:responseObject], nil);
+            LiveSession *liveSession = [self getLiveSessionFromMessageResponse:responseObject];
+            [self onCallbackQueue:^{ callback(true, liveSession, nil); }];
         } else {
-            callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+            [self onCallbackQueue:^{ callback(false, nil, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
         }
     } failure:^(NSURLSessionDataTask *task, NSError *error) {
         NSLog(@"closeLiveSession - error: %@", [error localizedDescription]);
-        callback(false, nil, [self errorMakingNetworkCall:error]);
+        [self onCallbackQueue:^{ callback(false, nil, [self errorMakingNetworkCall:error]); }];
     }];
 }
 
@@ -832,14 +2271,14 @@ constructingBodyWithBlock:
 
               NSLog(@"closeLiveSession - fetched %lu live sessions", (unsigned long)[liveSessionsArray count]);
 
-              callback(true, liveSessionsArray, nil);
+              [self onCallbackQueue:^{ callback(true, liveSessionsArray, nil); }];
           } else {
-              callback(false, nil, [self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_LIVE_SESSIONS]);
+              [self onCallbackQueue:^{ callback(false, nil, [self errorWithErrorString:ERROR_STRING_ERROR_FETCHING_LIVE_SESSIONS]); }];
           }
       }
       failure:^(NSURLSessionTask *operation, NSError *error) {
           NSLog(@"getRecentlyCreatedOpenLiveSessions - error: %@", [error localizedDescription]);
-          callback(false, nil, [self errorMakingNetworkCall:error]);
+          [self onCallbackQueue:^{ callback(false, nil, [self errorMakingNetworkCall:error]); }];
       }];
 }
 
@@ -859,7 +2298,8 @@ constructingBodyWithBlock:
                       progress:(void (^)(NSProgress * _Nonnull))uploadProgress
                        success:(void (^)(NSURLSessionDataTask * _Nonnull, id _Nullable))success
                        failure:(void (^)(NSURLSessionDataTask * _Nullable, NSError * _Nonnull))failure {
-    return [httpSessionManager POST:URLString parameters:[self signedParameters:parameters url:URLString] progress:uploadProgress success:success failure:failure];
+    return [httpSessionManager POST:URLString parameters:[self signedParameters:parameters url:URLString] progress:uploadProgress
+                            success:success failure:failure];
 }
 
 - (NSURLSessionDataTask *)GET:(NSString *)URLString
@@ -867,37 +2307,225 @@ constructingBodyWithBlock:
                      progress:(void (^)(NSProgress * _Nonnull))downloadProgress
                       success:(void (^)(NSURLSessionDataTask * _Nonnull, id _Nullable))success
                       failure:(void (^)(NSURLSessionDataTask * _Nullable, NSError * _Nonnull))failure {
-    return [httpSessionManager GET:URLString parameters:[self signedParameters:parameters url:URLString] progress:downloadProgress success:success failure:failure];
+    return [httpSessionManager GET:URLString parameters:[self signedParameters:parameters url:URLString] progress:downloadProgress
+                           success:success failure:failure];
+}
+
+// Conditional variant of GET above. When validators are passed the request carries If-None-Match/If-Modified-Since
+// headers. AFNetworking treats a 304 reply as an error so it is routed to the success block with a nil responseObject;
+// use isNotModifiedResponse: on the task's response to tell it apart.
+- (NSURLSessionDataTask *)GET:(NSString *)URLString
+                   parameters:(NSMutableDictionary *)parameters
+                   validators:(NSDictionary *)validators
+                      success:(void (^)(NSURLSessionDataTask *task, id responseObject))success
+                      failure:(void (^)(NSURLSessionDataTask *task, NSError *error))failure {
+    NSError *serializationError = nil;
+    NSMutableURLRequest *request = [httpSessionManager.requestSerializer requestWithMethod:@"GET" URLString:URLString
+                                                                                parameters:[self signedParameters:parameters url:URLString]
+                                                                                     error:&serializationError];
+    if (serializationError != nil) {
+        dispatch_async(processingQueue, ^{
+            failure(nil, serializationError);
+        });
+        return nil;
+    }
+
+    if (validators != nil) {
+        // We are revalidating ourselves so keep NSURLCache from answering the request or swallowing the 304
+        request.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+        [request setValue:validators[HTTP_HEADER_ETAG] forHTTPHeaderField:HTTP_HEADER_IF_NONE_MATCH];
+        [request setValue:validators[HTTP_HEADER_LAST_MODIFIED] forHTTPHeaderField:HTTP_HEADER_IF_MODIFIED_SINCE];
+    }
+
+    __block NSURLSessionDataTask *dataTask = [httpSessionManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil
+                                                                   completionHandler:^(NSURLResponse *response, id responseObject, NSError *error) {
+        if ([self isNotModifiedResponse:response]) {
+            success(dataTask, nil);
+        } else if (error != nil) {
+            failure(dataTask, error);
+        } else {
+            success(dataTask, responseObject);
+        }
+    }];
+
+    [dataTask resume];
+
+    return dataTask;
+}
+
+// GET against the streaming session. Every chunk of the response body goes to the parser and nothing else keeps it, so
+// the success block only says the whole body was received.
+- (NSURLSessionDataTask *)streamingGET:(NSString *)URLString
+                            parameters:(NSMutableDictionary *)parameters
+                                parser:(PatchListStreamParser *)parser
+                               success:(void (^)(NSURLSessionDataTask *task))success
+                               failure:(void (^)(NSURLSessionDataTask *task, NSError *error))failure {
+    NSError *serializationError = nil;
+    NSMutableURLRequest *request = [httpSessionManager.requestSerializer requestWithMethod:@"GET" URLString:URLString
+                                                                                parameters:[self signedParameters:parameters url:URLString]
+                                                                                     error:&serializationError];
+    if (serializationError != nil) {
+        dispatch_async(processingQueue, ^{
+            failure(nil, serializationError);
+        });
+        return nil;
+    }
+
+    // PatchListStreamParser only understands JSON so do not negotiate MessagePack for these (the request serializer is
+    // httpSessionManager's)
+    [request setValue:JSON_CONTENT_TYPE forHTTPHeaderField:HTTP_HEADER_ACCEPT];
+
+    __block NSURLSessionDataTask *dataTask = nil;
+    DataTaskHandler *handler = [[DataTaskHandler alloc] init];
+    handler.dataHandler = ^(NSData *data) {
+        [parser appendData:data];
+    };
+    handler.completionHandler = ^(NSURLResponse *response, NSError *error) {
+        if (error != nil) {
+            failure(dataTask, error);
+        } else {
+            success(dataTask);
+        }
+    };
+
+    dataTask = [self dataTaskWithSession:streamingSession request:request handler:handler];
+    [dataTask resume];
+
+    return dataTask;
+}
+
+#pragma mark - Streaming Sessions
+
+// The handler is registered before the task is returned (and so before it can be resumed) so it sees every callback
+- (NSURLSessionDataTask *)dataTaskWithSession:(NSURLSession *)session request:(NSURLRequest *)request handler:(DataTaskHandler *)handler {
+    NSURLSessionDataTask *dataTask = [session dataTaskWithRequest:request];
+    @synchronized (taskToDataTaskHandlerMapTable) {
+        [taskToDataTaskHandlerMapTable setObject:handler forKey:dataTask];
+    }
+    return dataTask;
+}
+
+- (DataTaskHandler *)dataTaskHandlerForTask:(NSURLSessionTask *)task {
+    @synchronized (taskToDataTaskHandlerMapTable) {
+        return [taskToDataTaskHandlerMapTable objectForKey:task];
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveResponse:(NSURLResponse *)response
+ completionHandler:(void (^)(NSURLSessionResponseDisposition disposition))completionHandler {
+    DataTaskHandler *handler = [self dataTaskHandlerForTask:dataTask];
+    if (handler.responseHandler != nil) {
+        handler.responseHandler(response);
+    }
+    completionHandler(NSURLSessionResponseAllow);
+}
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data {
+    DataTaskHandler *handler = [self dataTaskHandlerForTask:dataTask];
+    if (handler.dataHandler != nil) {
+        handler.dataHandler(data);
+    }
 }
 
+// As with AFHTTPResponseSerializer, a reply with a status code outside 2xx counts as a failure
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error {
+    DataTaskHandler *handler = nil;
+    @synchronized (taskToDataTaskHandlerMapTable) {
+        handler = [taskToDataTaskHandlerMapTable objectForKey:task];
+        [taskToDataTaskHandlerMapTable removeObjectForKey:task];
+    }
+
+    NSURLResponse *response = task.response;
+    if (error == nil && [response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSInteger statusCode = [(NSHTTPURLResponse *)response statusCode];
+        if (statusCode < 200 || statusCode >= 300) {
+            error = [self errorWithErrorString:[NSHTTPURLResponse localizedStringForStatusCode:statusCode]];
+        }
+    }
+
+    if (handler.completionHandler != nil) {
+        dispatch_async(processingQueue, ^{
+            handler.completionHandler(response, error);
+        });
+    }
+}
+
+#pragma mark - Request Coalescing
+
+// Only read-only calls (patch lists, patch info and patch versions) are coalesced, and they do it themselves: the first
+// caller makes the request and maps the response once, then completeInFlightRequest hands the mapped result to every
+// waiter. Calls that change anything on the service (every POST, deletePatch) always make their own request.
+
+// Requests are identified by method, URL and their parameters before signing (the random value and digest added by
+// signedParameters differ on every call). Extra is folded in for anything else that changes the request, e.g. headers.
+- (NSString *)inFlightRequestKeyForMethod:(NSString *)method url:(NSString *)url parameters:(NSDictionary *)parameters extra:(id)extra {
+    NSMutableString *requestKey = [NSMutableString stringWithFormat:@"%@ %@?", method, url];
+    for (NSString *key in [[parameters allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+        [requestKey appendFormat:@"%@=%@&", key, parameters[key]];
+    }
+    if (extra != nil) {
+        [requestKey appendFormat:@"#%@", extra];
+    }
+    return requestKey;
+}
+
+// Registers waiter for the request identified by requestKey. Returns YES if an identical request is already in flight,
+// in which case waiter will be called when it completes and the caller must not start its own request. Returns NO if
+// the caller is the first; it must start the request and call completeInFlightRequest when done.
+- (BOOL)joinInFlightRequest:(NSString *)requestKey waiter:(InFlightRequestWaiter)waiter {
+    @synchronized (inFlightRequestKeyToWaitersDictionary) {
+        NSMutableArray *waiters = inFlightRequestKeyToWaitersDictionary[requestKey];
+        if (waiters != nil) {
+            [waiters addObject:[waiter copy]];
+            return YES;
+        }
+
+        inFlightRequestKeyToWaitersDictionary[requestKey] = [NSMutableArray arrayWithObject:[waiter copy]];
+        return NO;
+    }
+}
+
+- (void)completeInFlightRequest:(NSString *)requestKey task:(NSURLSessionDataTask *)task responseObject:(id)responseObject error:(NSError *)error {
+    NSArray *waiters;
+    @synchronized (inFlightRequestKeyToWaitersDictionary) {
+        waiters = inFlightRequestKeyToWaitersDictionary[requestKey];
+        [inFlightRequestKeyToWaitersDictionary removeObjectForKey:requestKey];
+    }
+
+    for (InFlightRequestWaiter waiter in waiters) {
+        waiter(task, responseObject, error);
+    }
+}
+
+#pragma mark -
+
 - (NSDictionary *)signedParameters:(NSMutableDictionary *)parameters url:(NSString *)url {
-    if ([self isLocalEnvironment] && overrideRandomValue != nil) {
-        parameters[PARAM_KEY_RANDOM] = overrideRandomValue;
-        overrideRandomValue = nil;
+    // Some calls (e.g. updatePatch) sign on the processing queue while a test sets the overrides on its own thread
+    NSString *randomValue = nil;
+    NSString *digestValue = nil;
+    if ([self isLocalEnvironment]) {
+        @synchronized ([ChuckPadSocial class]) {
+            randomValue = overrideRandomValue;
+            digestValue = overrideDigestValue;
+            overrideRandomValue = nil;
+            overrideDigestValue = nil;
+        }
+    }
+
+    if (randomValue != nil) {
+        parameters[PARAM_KEY_RANDOM] = randomValue;
     } else {
         parameters[PARAM_KEY_RANDOM] = [[[NSProcessInfo processInfo] globallyUniqueString] stringByReplacingOccurrencesOfString:@"-" withString:@""];
     }
     
     parameters[PARAM_VERSION] = @(IOS_SDK_VERSION);
     
-    NSMutableDictionary *signedParameters = [[NSMutableDictionary alloc] init];
-    
-    NSArray *sortedKeys = [[parameters allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)];
-    
-    NSMutableString *digest = [[NSMutableString alloc] init];
-    
-    for (NSString *key in sortedKeys) {
-        [digest appendString:key];
-        [digest appendFormat:@"%@", parameters[key]];
-        
-        signedParameters[key] = parameters[key];
-    }
+    NSMutableDictionary *signedParameters = [parameters mutableCopy];
     
-    if ([self isLocalEnvironment] && overrideDigestValue != nil) {
-        signedParameters[PARAM_KEY_DIGEST] = overrideDigestValue;
-        overrideDigestValue = nil;
+    if (digestValue != nil) {
+        signedParameters[PARAM_KEY_DIGEST] = digestValue;
     } else {
-        signedParameters[PARAM_KEY_DIGEST] = [self SHA256hexDigestForData:[digest dataUsingEncoding:NSUTF8StringEncoding]];
+        signedParameters[PARAM_KEY_DIGEST] = [RequestDigest digestForParameters:parameters];
     }
     
     return signedParameters;
@@ -915,41 +2543,76 @@ constructingBodyWithBlock:
     }
 }
 
+// Returns data compressed in gzip format (RFC 1952) or nil if zlib fails
+static NSData *gzipData(NSData *data) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    // 15 window bits plus 16 selects the gzip wrapper instead of the zlib one
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return nil;
+    }
+
+    NSMutableData *compressedData = [NSMutableData dataWithLength:deflateBound(&stream, (uLong)[data length])];
+    stream.next_in = (Bytef *)[data bytes];
+    stream.avail_in = (uInt)[data length];
+    stream.next_out = [compressedData mutableBytes];
+    stream.avail_out = (uInt)[compressedData length];
+
+    int status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        return nil;
+    }
+
+    [compressedData setLength:stream.total_out];
+    return compressedData;
+}
+
 - (void)appendFormData:(id<AFMultipartFormData>)formData patchData:(NSData *)patchData extraData:(NSData *)extraData {
     if (patchData != nil) {
         NSLog(@"formDataAppendHelper - appending patchData data");
-        [formData appendPartWithFileData:patchData name:PATCH_DATA_PARAM_NAME fileName:@"data"
-                                mimeType:FILE_DATA_MIME_TYPE];
+        [self appendFilePartToFormData:formData data:patchData name:PATCH_DATA_PARAM_NAME fileName:@"data"];
     }
     
     if (extraData != nil) {
         NSLog(@"formDataAppendHelper - appending extraData data");
-        [formData appendPartWithFileData:extraData name:PATCH_EXTRA_DATA_PARAM_NAME fileName:@"extra_data"
-                                mimeType:FILE_DATA_MIME_TYPE];
+        [self appendFilePartToFormData:formData data:extraData name:PATCH_EXTRA_DATA_PARAM_NAME fileName:@"extra_data"];
     }
 }
 
-// SHA256 hex digest adapted from: http://stackoverflow.com/a/7520655/265791
-- (NSString *)SHA256hexDigestForData:(NSData *)data {
-    NSMutableData *sha256Out = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
-    CC_SHA256(data.bytes, (CC_LONG)data.length, sha256Out.mutableBytes);
-    NSUInteger capacity = sha256Out.length * 2;
-    NSMutableString *hexDigestString = [NSMutableString stringWithCapacity:capacity];
-    const unsigned char *buf = sha256Out.bytes;
-    NSInteger i;
-    for (i = 0; i < sha256Out.length; ++i) {
-        [hexDigestString appendFormat:@"%02X", buf[i]];
+// With upload compression enabled a part is gzipped and marked with a Content-Encoding part header, which the service
+// undoes before storing it. Parts are sent as is when compression is off, when they are small, or when gzip does not
+// make them meaningfully smaller (e.g. data that is already compressed).
+- (void)appendFilePartToFormData:(id<AFMultipartFormData>)formData data:(NSData *)data name:(NSString *)name fileName:(NSString *)fileName {
+    NSData *compressedData = nil;
+    if (uploadCompressionEnabled && [data length] >= UPLOAD_COMPRESSION_MIN_BYTES) {
+        compressedData = gzipData(data);
+        if ([compressedData length] > [data length] / 10 * 9) {
+            compressedData = nil;
+        }
+    }
+
+    if (compressedData == nil) {
+        [formData appendPartWithFileData:data name:name fileName:fileName mimeType:FILE_DATA_MIME_TYPE];
+        return;
     }
-    return hexDigestString;
+
+    NSLog(@"appendFilePartToFormData - compressed %@ from %lu to %lu bytes", name, (unsigned long)[data length], (unsigned long)[compressedData length]);
+
+    NSDictionary *headers = @{ @"Content-Disposition" : [NSString stringWithFormat:@"form-data; name=\"%@\"; filename=\"%@\"", name, fileName],
+                               @"Content-Type" : FILE_DATA_MIME_TYPE,
+                               HTTP_HEADER_CONTENT_ENCODING : CONTENT_ENCODING_GZIP };
+    [formData appendPartWithHeaders:headers body:compressedData];
 }
 
 - (void)processAuthResponse:(id)responseObject callback:(CreateUserCallback)callback {
     if ([self responseOk:responseObject]) {
         // If a valid create user or login call, persist user credentials to keychain
         [self authSucceededWithUser:[self getUserFromMessageResponse:responseObject]];
-        callback(true, nil);
+        [self onCallbackQueue:^{ callback(true, nil); }];
     } else {
-        callback(false, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]);
+        [self onCallbackQueue:^{ callback(false, [self errorWithErrorString:[self getErrorMessageFromServiceReply:responseObject]]); }];
     }
 }
 
@@ -962,23 +2625,27 @@ constructingBodyWithBlock:
 
 // Constructs a Patch object from the JSON in the "message" response body
 - (Patch *)getPatchFromMessageResponse:(id)responseObject {
-    NSData *data = [[responseObject objectForKey:@"message"] dataUsingEncoding:NSUTF8StringEncoding];
-    id json = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
-    return [[Patch alloc] initWithDictionary:json];
+    return [[PatchIdentityMap sharedInstance] patchForDictionary:[self getDecodedMessageFromResponse:responseObject]];
 }
 
 // Constructs a LiveSession object from the JSON in the "message" response body
 - (LiveSession *)getLiveSessionFromMessageResponse:(id)responseObject {
-    NSData *data = [[responseObject objectForKey:@"message"] dataUsingEncoding:NSUTF8StringEncoding];
-    id json = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
-    return [[LiveSession alloc] initWithDictionary:json];
+    return [[LiveSession alloc] initWithDictionary:[self getDecodedMessageFromResponse:responseObject]];
 }
 
 // Returns a list of JSON blobs contained in the "message" response body
 - (NSArray *)getPatchListFromMessageResponse:(id)responseObject {
-    NSData *data = [[responseObject objectForKey:@"message"] dataUsingEncoding:NSUTF8StringEncoding];
-    NSArray *json = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
-    return json;
+    return [self getDecodedMessageFromResponse:responseObject];
+}
+
+// ChuckPadResponseSerializer has normally already decoded the JSON inside the "message" string. If the message is still
+// a string (e.g. the response came through a different serializer) decode it here.
+- (id)getDecodedMessageFromResponse:(id)responseObject {
+    id message = [responseObject objectForKey:@"message"];
+    if ([message isKindOfClass:[NSString class]]) {
+        return [ChuckPadResponseSerializer JSONObjectFromMessageString:message];
+    }
+    return message;
 }
 
 // Returns an array of PatchResource objects containing in the "message" response body
@@ -1032,9 +2699,37 @@ constructingBodyWithBlock:
     return YES;
 }
 
+- (BOOL)isNotModifiedResponse:(NSURLResponse *)response {
+    return [response isKindOfClass:[NSHTTPURLResponse class]] && [(NSHTTPURLResponse *)response statusCode] == HTTP_NOT_MODIFIED;
+}
+
+// Pulls the ETag and Last-Modified headers out of the response. Header names are matched case-insensitively because
+// Foundation does not guarantee the casing the server used is preserved in allHeaderFields.
+- (NSDictionary *)validatorsFromResponse:(NSURLResponse *)response {
+    if (![response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return nil;
+    }
+
+    NSMutableDictionary *validators = [[NSMutableDictionary alloc] init];
+    NSDictionary *headers = [(NSHTTPURLResponse *)response allHeaderFields];
+    for (NSString *header in headers) {
+        for (NSString *validatorHeader in @[HTTP_HEADER_ETAG, HTTP_HEADER_LAST_MODIFIED]) {
+            if ([header caseInsensitiveCompare:validatorHeader] == NSOrderedSame) {
+                validators[validatorHeader] = headers[header];
+            }
+        }
+    }
+
+    return [validators count] > 0 ? validators : nil;
+}
+
 - (NSError *)errorMakingNetworkCall:(NSError *)error {
-    if (networkErrorCallback != nil) {
-        networkErrorCallback();
+    void (^callback)(void) = nil;
+    @synchronized ([ChuckPadSocial class]) {
+        callback = networkErrorCallback;
+    }
+    if (callback != nil) {
+        callback();
     }
     
     NSDictionary *details = @{NSLocalizedDescriptionKey : [error localizedDescription]};
@@ -1064,19 +2759,27 @@ static NSString *overrideDigestValue;
 static void (^networkErrorCallback)(void);
 
 + (void)overrideRandomValueForNextRequest:(NSString *)randomValue {
-    overrideRandomValue = randomValue;
+    @synchronized ([ChuckPadSocial class]) {
+        overrideRandomValue = randomValue;
+    }
 }
 
 + (void)overrideDigestValueForNextRequest:(NSString *)digestValue {
-    overrideDigestValue = digestValue;
+    @synchronized ([ChuckPadSocial class]) {
+        overrideDigestValue = digestValue;
+    }
 }
 
 + (void)setNetworkErrorCallback:(void (^)(void))block {
-    networkErrorCallback = block;
+    @synchronized ([ChuckPadSocial class]) {
+        networkErrorCallback = block;
+    }
 }
 
 + (void)clearNetworkErrorCallback {
-    networkErrorCallback = nil;
+    @synchronized ([ChuckPadSocial class]) {
+        networkErrorCallback = nil;
+    }
 }
 
 + (void)resetSharedInstanceAndBoostrap {
@@ -8,20 +8,11 @@
 #import <Foundation/Foundation.h>
 
 #import "LiveSession.h"
+#import "TimestampFormatter.h"
 
 @implementation LiveSession
 
-static NSDateFormatter *dateFormatter;
-
 - (LiveSession *)initWithDictionary:(NSDictionary *)dictionary {
-    // Initialize our static date formatter so we can convert Ruby DateTime objects to NSDate's properly
-    // http://stackoverflow.com/a/26803370/265791
-    // http://stackoverflow.com/a/9132422/265791
-    if (dateFormatter == nil) {
-        dateFormatter = [NSDateFormatter new];
-        [dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
-    }
-    
     if (self = [super init]) {
         self.sessionGUID = dictionary[@"session_guid"];
         self.creatorID = [dictionary[@"creator_id"] integerValue];
@@ -29,8 +20,8 @@ static NSDateFormatter *dateFormatter;
         self.creatorUsername = dictionary[@"creator_username"];
         self.state = [dictionary[@"state"] integerValue];
         self.occupancy = [dictionary[@"occupancy"] integerValue];
-        self.createdAt = [dateFormatter dateFromString:dictionary[@"created_at"]];
-        self.lastActive = [dateFormatter dateFromString:dictionary[@"last_active"]];
+        self.createdAt = [TimestampFormatter dateFromString:dictionary[@"created_at"]];
+        self.lastActive = [TimestampFormatter dateFromString:dictionary[@"last_active"]];
         
         if (dictionary[@"session_data"] != nil) {
             self.sessionData = [[NSData alloc] initWithBase64EncodedData:dictionary[@"session_data"] options:NSDataBase64DecodingIgnoreUnknownCharacters];
@@ -55,8 +46,8 @@ static NSDateFormatter *dateFormatter;
               @"creator_username" : self.creatorUsername,
               @"state" : @(self.state),
               @"occupancy" : @(self.occupancy),
-              @"created_at" : [dateFormatter stringFromDate:self.createdAt],
-              @"last_active" : [dateFormatter stringFromDate:self.lastActive] };
+              @"created_at" : [TimestampFormatter stringFromDate:self.createdAt],
+              @"last_active" : [TimestampFormatter stringFromDate:self.lastActive] };
 }
 
 @end
@@ -0,0 +1,21 @@
+//
+//  MessagePackDecoder.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Decodes MessagePack (https://msgpack.org) into the same Foundation objects NSJSONSerialization produces: maps
+//  become NSDictionary, arrays NSArray, strings NSString, integers/floats/booleans NSNumber and nil NSNull. Binary
+//  values become NSData. Extension types (including timestamps) have no JSON counterpart and decode to NSNull.
+//
+//  Map keys repeat once per element in a patch list so each distinct key is only turned into an NSString once per
+//  document; later occurrences share that instance.
+
+#import <Foundation/Foundation.h>
+
+@interface MessagePackDecoder : NSObject
+
+// Returns the object encoded in data, or nil (setting error if given) if data is not exactly one well-formed
+// MessagePack value.
++ (id)objectWithData:(NSData *)data error:(NSError **)error;
+
+@end
@@ -0,0 +1,298 @@
+//
+//  MessagePackDecoder.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Single pass recursive descent over the input bytes. Like PatchListStreamParser the readers are plain C functions
+//  since they run once per value of what can be a very large list.
+
+#import "MessagePackDecoder.h"
+
+// Deeper documents than this are rejected rather than risking the stack on hostile input
+static const NSUInteger MAX_NESTING_DEPTH = 128;
+
+// Number of distinct map keys interned per document. Patch and LiveSession dictionaries have fewer keys than this.
+#define KEY_CACHE_SIZE 64
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger position;
+    NSUInteger depth;
+    BOOL failed;
+
+    // Interned map keys: where each key was first seen in bytes and the string made from it
+    NSUInteger keyCount;
+    NSUInteger keyOffsets[KEY_CACHE_SIZE];
+    NSUInteger keyLengths[KEY_CACHE_SIZE];
+    __unsafe_unretained NSMutableArray *keyStrings;
+} MessagePackReader;
+
+static id readValue(MessagePackReader *reader);
+
+static BOOL canRead(MessagePackReader *reader, uint64_t byteCount) {
+    if (reader->failed || reader->length - reader->position < byteCount) {
+        reader->failed = YES;
+        return NO;
+    }
+    return YES;
+}
+
+// Reads a big-endian unsigned integer of byteCount (1, 2, 4 or 8) bytes
+static BOOL readUnsigned(MessagePackReader *reader, NSUInteger byteCount, uint64_t *value) {
+    if (!canRead(reader, byteCount)) {
+        return NO;
+    }
+
+    uint64_t result = 0;
+    for (NSUInteger i = 0; i < byteCount; i++) {
+        result = (result << 8) | reader->bytes[reader->position++];
+    }
+    *value = result;
+    return YES;
+}
+
+static NSString *readString(MessagePackReader *reader, uint64_t length) {
+    if (!canRead(reader, length)) {
+        return nil;
+    }
+
+    NSString *string = [[NSString alloc] initWithBytes:reader->bytes + reader->position length:(NSUInteger)length encoding:NSUTF8StringEncoding];
+    if (string == nil) {
+        reader->failed = YES;
+        return nil;
+    }
+    reader->position += length;
+    return string;
+}
+
+// Returns the length of the string that starts at the current position (consuming its header) or NO if the next value
+// is not a string.
+static BOOL readStringHeader(MessagePackReader *reader, uint64_t *length) {
+    if (!canRead(reader, 1)) {
+        return NO;
+    }
+
+    uint8_t type = reader->bytes[reader->position];
+    if ((type & 0xe0) == 0xa0) {
+        reader->position++;
+        *length = type & 0x1f;
+        return YES;
+    }
+
+    NSUInteger lengthByteCount = type == 0xd9 ? 1 : type == 0xda ? 2 : type == 0xdb ? 4 : 0;
+    if (lengthByteCount == 0) {
+        return NO;
+    }
+    reader->position++;
+    return readUnsigned(reader, lengthByteCount, length);
+}
+
+static id readKey(MessagePackReader *reader) {
+    uint64_t length;
+    if (!readStringHeader(reader, &length)) {
+        // Non-string keys are legal MessagePack, just not something the service sends
+        return reader->failed ? nil : readValue(reader);
+    }
+
+    if (!canRead(reader, length)) {
+        return nil;
+    }
+
+    const uint8_t *keyBytes = reader->bytes + reader->position;
+    for (NSUInteger i = 0; i < reader->keyCount; i++) {
+        if (reader->keyLengths[i] == length && memcmp(reader->bytes + reader->keyOffsets[i], keyBytes, (size_t)length) == 0) {
+            reader->position += length;
+            return reader->keyStrings[i];
+        }
+    }
+
+    NSUInteger keyOffset = reader->position;
+    NSString *key = readString(reader, length);
+    if (key != nil && reader->keyCount < KEY_CACHE_SIZE) {
+        reader->keyOffsets[reader->keyCount] = keyOffset;
+        reader->keyLengths[reader->keyCount] = (NSUInteger)length;
+        [reader->keyStrings addObject:key];
+        reader->keyCount++;
+    }
+    return key;
+}
+
+static id readArray(MessagePackReader *reader, uint64_t count) {
+    // Every element takes at least one byte so a count larger than what is left is malformed; checking it up front
+    // keeps a bogus header from making us reserve a huge array.
+    if (!canRead(reader, count) || reader->depth >= MAX_NESTING_DEPTH) {
+        reader->failed = YES;
+        return nil;
+    }
+
+    reader->depth++;
+    NSMutableArray *array = [[NSMutableArray alloc] initWithCapacity:(NSUInteger)count];
+    for (uint64_t i = 0; i < count; i++) {
+        id value = readValue(reader);
+        if (value == nil) {
+            return nil;
+        }
+        [array addObject:value];
+    }
+    reader->depth--;
+    return array;
+}
+
+static id readMap(MessagePackReader *reader, uint64_t count) {
+    if (count > UINT64_MAX / 2 || !canRead(reader, count * 2) || reader->depth >= MAX_NESTING_DEPTH) {
+        reader->failed = YES;
+        return nil;
+    }
+
+    reader->depth++;
+    NSMutableDictionary *dictionary = [[NSMutableDictionary alloc] initWithCapacity:(NSUInteger)count];
+    for (uint64_t i = 0; i < count; i++) {
+        id key = readKey(reader);
+        id value = key != nil ? readValue(reader) : nil;
+        if (value == nil) {
+            return nil;
+        }
+        dictionary[key] = value;
+    }
+    reader->depth--;
+    return dictionary;
+}
+
+// Skips the payload of an extension value; see the header for why they decode to NSNull
+static id skipExtension(MessagePackReader *reader, uint64_t length) {
+    // One byte of extension type precedes the data
+    if (!canRead(reader, length + 1)) {
+        return nil;
+    }
+    reader->position += length + 1;
+    return [NSNull null];
+}
+
+static id readValue(MessagePackReader *reader) {
+    if (!canRead(reader, 1)) {
+        return nil;
+    }
+
+    uint8_t type = reader->bytes[reader->position++];
+
+    // Types that carry their value or length in the type byte itself
+    if (type <= 0x7f) {
+        return @((long long)type);
+    } else if (type >= 0xe0) {
+        return @((long long)(int8_t)type);
+    } else if ((type & 0xf0) == 0x80) {
+        return readMap(reader, type & 0x0f);
+    } else if ((type & 0xf0) == 0x90) {
+        return readArray(reader, type & 0x0f);
+    } else if ((type & 0xe0) == 0xa0) {
+        return readString(reader, type & 0x1f);
+    }
+
+    uint64_t value;
+    switch (type) {
+        case 0xc0:
+            return [NSNull null];
+        case 0xc2:
+            return @NO;
+        case 0xc3:
+            return @YES;
+
+        case 0xc4:
+        case 0xc5:
+        case 0xc6:
+            if (!readUnsigned(reader, 1 << (type - 0xc4), &value) || !canRead(reader, value)) {
+                return nil;
+            }
+            reader->position += value;
+            return [NSData dataWithBytes:reader->bytes + reader->position - value length:(NSUInteger)value];
+
+        case 0xc7:
+        case 0xc8:
+        case 0xc9:
+            return readUnsigned(reader, 1 << (type - 0xc7), &value) ? skipExtension(reader, value) : nil;
+
+        case 0xca: {
+            if (!readUnsigned(reader, 4, &value)) {
+                return nil;
+            }
+            uint32_t bits = (uint32_t)value;
+            float floatValue;
+            memcpy(&floatValue, &bits, sizeof(floatValue));
+            return @(floatValue);
+        }
+        case 0xcb: {
+            if (!readUnsigned(reader, 8, &value)) {
+                return nil;
+            }
+            double doubleValue;
+            memcpy(&doubleValue, &value, sizeof(doubleValue));
+            return @(doubleValue);
+        }
+
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+            return readUnsigned(reader, 1 << (type - 0xcc), &value) ? @((unsigned long long)value) : nil;
+
+        case 0xd0:
+            return readUnsigned(reader, 1, &value) ? @((long long)(int8_t)value) : nil;
+        case 0xd1:
+            return readUnsigned(reader, 2, &value) ? @((long long)(int16_t)value) : nil;
+        case 0xd2:
+            return readUnsigned(reader, 4, &value) ? @((long long)(int32_t)value) : nil;
+        case 0xd3:
+            return readUnsigned(reader, 8, &value) ? @((long long)(int64_t)value) : nil;
+
+        case 0xd4:
+        case 0xd5:
+        case 0xd6:
+        case 0xd7:
+        case 0xd8:
+            return skipExtension(reader, 1 << (type - 0xd4));
+
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            return readUnsigned(reader, 1 << (type - 0xd9), &value) ? readString(reader, value) : nil;
+
+        case 0xdc:
+        case 0xdd:
+            return readUnsigned(reader, type == 0xdc ? 2 : 4, &value) ? readArray(reader, value) : nil;
+
+        case 0xde:
+        case 0xdf:
+            return readUnsigned(reader, type == 0xde ? 2 : 4, &value) ? readMap(reader, value) : nil;
+
+        default:
+            // 0xc1 is never used
+            reader->failed = YES;
+            return nil;
+    }
+}
+
+@implementation MessagePackDecoder
+
++ (id)objectWithData:(NSData *)data error:(NSError **)error {
+    NSMutableArray *keyStrings = [[NSMutableArray alloc] init];
+
+    MessagePackReader reader = {0};
+    reader.bytes = data.bytes;
+    reader.length = data.length;
+    reader.keyStrings = keyStrings;
+
+    id object = readValue(&reader);
+    if (object == nil || reader.failed || reader.position != reader.length) {
+        if (error != NULL) {
+            NSString *description = [NSString stringWithFormat:@"Malformed MessagePack data at byte %lu", (unsigned long)reader.position];
+            *error = [NSError errorWithDomain:NSCocoaErrorDomain code:NSPropertyListReadCorruptError
+                                     userInfo:@{NSLocalizedDescriptionKey : description}];
+        }
+        return nil;
+    }
+
+    return object;
+}
+
+@end
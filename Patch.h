@@ -36,6 +36,15 @@
 
 - (Patch *)initWithDictionary:(NSDictionary *)dictionary;
 
+// Overwrites every property with the values in dictionary. Patches are shared between lists (see PatchIdentityMap)
+// and are updated this way on a background queue when a call returns different values for them. Properties are set
+// one at a time and are not atomic, so a shared patch must not be read while a call that returns it is completing.
+- (void)updateWithDictionary:(NSDictionary *)dictionary;
+
+// Whether every property updateWithDictionary would set already has the value in dictionary. Lets PatchIdentityMap
+// leave patches that did not change alone.
+- (BOOL)isUpToDateWithDictionary:(NSDictionary *)dictionary;
+
 - (NSDictionary *)asDictionary;
 
 - (BOOL)hasParentPatch;
@@ -10,44 +10,58 @@
 #import "Patch.h"
 #import "ChuckPadSocial.h"
 #import "NSDate+Helper.h"
+#import "TimestampFormatter.h"
 
 @implementation Patch
 
-static NSDateFormatter *dateFormatter;
+// Unlike isEqual: this treats two nils as equal
+static BOOL objectsEqual(id first, id second) {
+    return first == second || [first isEqual:second];
+}
 
 - (Patch *)initWithDictionary:(NSDictionary *)dictionary {
-    // Initialize our static date formatter so we can convert Ruby DateTime objects to NSDate's properly
-    // http://stackoverflow.com/a/26803370/265791
-    // http://stackoverflow.com/a/9132422/265791
-    if (dateFormatter == nil) {
-        dateFormatter = [NSDateFormatter new];
-        [dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
-    }
-
     if (self = [super init]) {
-        self.guid = dictionary[@"guid"];
-        self.name = dictionary[@"name"];
-        self.patchDescription = dictionary[@"description"];
-        self.isFeatured = [dictionary[@"featured"] boolValue];
-        self.isDocumentation = [dictionary[@"documentation"] boolValue];
-        self.hidden = [dictionary[@"hidden"] boolValue];
-        self.latitude = [self safeGetNumberForKey:@"latitude" fromDictionary:dictionary];
-        self.longitude = [self safeGetNumberForKey:@"longitude" fromDictionary:dictionary];
-        self.creatorId = [dictionary[@"creator_id"] integerValue];
-        self.creatorUsername = dictionary[@"creator_username"];
-        self.abuseReportCount = [dictionary[@"abuse_count"] integerValue];
-        self.resourceUrl = dictionary[@"resource"];
-        self.createdAt = [dateFormatter dateFromString:dictionary[@"created_at"]];
-        self.updatedAt = [dateFormatter dateFromString:dictionary[@"updated_at"]];
-        self.downloadCount = [dictionary[@"download_count"] integerValue];
-        self.parentGUID = [self safeGetStringForKey:@"parent_guid" fromDictionary:dictionary];
-        self.revision = [dictionary[@"revision"] integerValue];
-        self.extraResourceUrl = [self safeGetStringForKey:@"extra_resource" fromDictionary:dictionary];
+        [self updateWithDictionary:dictionary];
     }
 
     return self;
 }
 
+- (void)updateWithDictionary:(NSDictionary *)dictionary {
+    self.guid = dictionary[@"guid"];
+    self.name = dictionary[@"name"];
+    self.patchDescription = dictionary[@"description"];
+    self.isFeatured = [dictionary[@"featured"] boolValue];
+    self.isDocumentation = [dictionary[@"documentation"] boolValue];
+    self.hidden = [dictionary[@"hidden"] boolValue];
+    self.latitude = [self safeGetNumberForKey:@"latitude" fromDictionary:dictionary];
+    self.longitude = [self safeGetNumberForKey:@"longitude" fromDictionary:dictionary];
+    self.creatorId = [dictionary[@"creator_id"] integerValue];
+    self.creatorUsername = dictionary[@"creator_username"];
+    self.abuseReportCount = [dictionary[@"abuse_count"] integerValue];
+    self.resourceUrl = dictionary[@"resource"];
+    self.createdAt = [TimestampFormatter dateFromString:dictionary[@"created_at"]];
+    self.updatedAt = [TimestampFormatter dateFromString:dictionary[@"updated_at"]];
+    self.downloadCount = [dictionary[@"download_count"] integerValue];
+    self.parentGUID = [self safeGetStringForKey:@"parent_guid" fromDictionary:dictionary];
+    self.revision = [dictionary[@"revision"] integerValue];
+    self.extraResourceUrl = [self safeGetStringForKey:@"extra_resource" fromDictionary:dictionary];
+}
+
+// Compares against the dictionary mapped the same way updateWithDictionary maps it so every field it sets is covered
+- (BOOL)isUpToDateWithDictionary:(NSDictionary *)dictionary {
+    Patch *other = [[Patch alloc] initWithDictionary:dictionary];
+    return objectsEqual(self.guid, other.guid) && objectsEqual(self.name, other.name) &&
+           objectsEqual(self.patchDescription, other.patchDescription) && self.isFeatured == other.isFeatured &&
+           self.isDocumentation == other.isDocumentation && self.hidden == other.hidden &&
+           objectsEqual(self.latitude, other.latitude) && objectsEqual(self.longitude, other.longitude) &&
+           self.creatorId == other.creatorId && objectsEqual(self.creatorUsername, other.creatorUsername) &&
+           self.abuseReportCount == other.abuseReportCount && objectsEqual(self.resourceUrl, other.resourceUrl) &&
+           objectsEqual(self.createdAt, other.createdAt) && objectsEqual(self.updatedAt, other.updatedAt) &&
+           self.downloadCount == other.downloadCount && objectsEqual(self.parentGUID, other.parentGUID) &&
+           self.revision == other.revision && objectsEqual(self.extraResourceUrl, other.extraResourceUrl);
+}
+
 // Use this method to get any parameters that may come down null or are optional. We default to using @"" when not
 // present over nil so we can more implement the asDictionary and equals methods.
 - (NSString *)safeGetStringForKey:(NSString *)key fromDictionary:(NSDictionary *)dictionary {
@@ -79,8 +93,8 @@ static NSDateFormatter *dateFormatter;
               @"creator_username" : self.creatorUsername,
               @"abuse_count" : @(self.abuseReportCount),
               @"resource" : self.resourceUrl,
-              @"created_at" : [dateFormatter stringFromDate:self.createdAt],
-              @"updated_at" : [dateFormatter stringFromDate:self.updatedAt],
+              @"created_at" : [TimestampFormatter stringFromDate:self.createdAt],
+              @"updated_at" : [TimestampFormatter stringFromDate:self.updatedAt],
               @"download_count" : @(self.downloadCount),
               @"parent_guid" : self.parentGUID,
               @"revision" : @(self.revision),
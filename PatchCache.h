@@ -7,18 +7,80 @@
 // If no expiring time is specified, this default will be used.
 extern const int TIME_TO_LIVE_SECONDS;
 
+// If no byte limit is specified, this default will be used.
+extern const NSUInteger PATCH_CACHE_BYTE_LIMIT;
+
+// Every object stored is given a cost equal to its (estimated) size in bytes: the length of NSData, and the summed
+// string and data sizes of Patch and LiveSession objects (including ones inside arrays). NSCache evicts once the total
+// cost goes over byteLimit.
 @interface PatchCache : NSCache
 
 + (PatchCache *)sharedInstance;
 
+// Memory tier budget in bytes. Backed by NSCache's totalCostLimit.
+@property(nonatomic, assign) NSUInteger byteLimit;
+
+// Memory tier statistics since launch (or the last resetStatistics call). Evictions only count objects NSCache dropped
+// on its own because of the byte limit or memory pressure, not explicit removals.
+- (NSUInteger)hitCount;
+
+- (NSUInteger)missCount;
+
+- (NSUInteger)evictionCount;
+
+- (void)resetStatistics;
+
 - (id)objectForKey:(id)key;
 
 - (void)setObject:(id)obj forKey:(id)key;
 
 - (void)setObject:(id)obj forKey:(id)key expire:(NSInteger)seconds;
 
+// HTTP validators (i.e. ETag and Last-Modified response headers) for the object stored under key. Objects that have
+// validators are kept around after they expire so they can be revalidated with a conditional GET instead of being
+// fetched again in full.
+- (void)setValidators:(NSDictionary *)validators forKey:(id)key;
+
+- (NSDictionary *)validatorsForKey:(id)key;
+
+// Returns the object stored under key even if it has expired. Returns nil if there is no object stored.
+- (id)staleObjectForKey:(id)key;
+
+// Resource data is cached in two tiers: the in-memory tier above and a persistent PatchDiskCache tier below it. These
+// should only be used for immutable content (e.g. a specific revision of a patch resource) as the disk tier does not
+// expire entries. Disk hits are promoted back into the memory tier. A memory miss reads the disk tier synchronously so
+// dataForKey: should not be called on the main thread.
+- (NSData *)dataForKey:(NSString *)key;
+
+- (void)setData:(NSData *)data forKey:(NSString *)key;
+
+// Removes data stored with setData:forKey: from both tiers.
+- (void)removeDataForKey:(NSString *)key;
+
+// Removes key from the memory tier only; data stored with setData:forKey: stays on disk. Use removeDataForKey: for that.
 - (void)removeObjectForKey:(id)key;
 
+// Removes every object whose key starts with prefix (e.g. all cached pages of a paged list).
+- (void)removeObjectsForKeyPrefix:(NSString *)prefix;
+
+// Removes every cached patch list that contains the patch with the given GUID (e.g. after that patch was deleted).
+- (void)removeObjectsContainingPatchGUID:(NSString *)guid;
+
+// Returns every cached patch list (expired or not) that contains the patch with the given GUID, keyed by cache key.
+- (NSDictionary *)objectsContainingPatchGUID:(NSString *)guid;
+
+// Replaces the object stored under key without changing when it expires. Does nothing if nothing is stored under key.
+- (void)replaceObject:(id)obj forKey:(id)key;
+
+// Like replaceObject:forKey: but only if the object stored under key is currently expectedObj itself. Returns whether
+// the object was replaced.
+- (BOOL)replaceObject:(id)expectedObj withObject:(id)obj forKey:(id)key;
+
+// Empties the memory tier. Resource data on disk is immutable and not tied to the logged in user (keys include the
+// revision) so it survives this, and with it logging in and out.
 - (void)removeAllObjects;
 
+// Empties both tiers, e.g. to free up storage or when the persisted data itself is suspect.
+- (void)removeAllObjectsAndData;
+
 @end
\ No newline at end of file
@@ -4,11 +4,49 @@
 
 #import "PatchCache.h"
 
+#import <stdatomic.h>
+
+#import "LiveSession.h"
+#import "Patch.h"
+#import "PatchDiskCache.h"
+
 // Default cache TTL is 5 minutes
 int const TIME_TO_LIVE_SECONDS = 5 * 60;
 
+// Default memory budget is 16 MB
+NSUInteger const PATCH_CACHE_BYTE_LIMIT = 16 * 1024 * 1024;
+
+// Rough per-object cost of an NSObject plus its ivars used when estimating model object sizes
+static const NSUInteger OBJECT_OVERHEAD_COST = 64;
+
+// NSCache stores one of these per key. Having our own wrapper lets the eviction delegate callback know which key was
+// evicted and whether the removal was one we asked for or one NSCache decided on by itself.
+@interface PatchCacheEntry : NSObject
+
+@property(nonatomic, retain) id key;
+@property(nonatomic, retain) id object;
+@property(atomic, assign) BOOL removedExplicitly;
+
+@end
+
+@implementation PatchCacheEntry
+@end
+
+@interface PatchCache () <NSCacheDelegate>
+@end
+
+// All expiry and validator bookkeeping goes through a concurrent queue used as a reader/writer lock: lookups run
+// concurrently with dispatch_sync while mutations use barriers. NSCache itself is already thread-safe but the two
+// dictionaries are touched from AFNetworking completion blocks and NSURLSession callbacks on arbitrary queues. Updates
+// to the NSCache storage happen inside the same barriers so an object and its expire time always change together.
 @implementation PatchCache {
     @private NSMutableDictionary *keyToExpireTimeDictionary;
+    @private NSMutableDictionary *keyToValidatorsDictionary;
+    @private dispatch_queue_t bookkeepingQueue;
+    @private BOOL removingAllObjects;
+    @private _Atomic(NSUInteger) hitCount;
+    @private _Atomic(NSUInteger) missCount;
+    @private _Atomic(NSUInteger) evictionCount;
 }
 
 + (PatchCache *)sharedInstance {
@@ -24,49 +62,326 @@ int const TIME_TO_LIVE_SECONDS = 5 * 60;
     self = [super init];
     if (self) {
         keyToExpireTimeDictionary = [[NSMutableDictionary alloc] init];
+        keyToValidatorsDictionary = [[NSMutableDictionary alloc] init];
+        bookkeepingQueue = dispatch_queue_create("chuckpad-social.patch-cache", DISPATCH_QUEUE_CONCURRENT);
+        self.totalCostLimit = PATCH_CACHE_BYTE_LIMIT;
+        self.delegate = self;
     }
     return self;
 }
 
+- (NSUInteger)byteLimit {
+    return self.totalCostLimit;
+}
+
+- (void)setByteLimit:(NSUInteger)byteLimit {
+    self.totalCostLimit = byteLimit;
+}
+
 - (id)objectForKey:(id)key {
-    id obj = [super objectForKey:key];
+    __block id obj = nil;
+    __block BOOL expired = NO;
+    __block BOOL hasValidators = NO;
+    dispatch_sync(bookkeepingQueue, ^{
+        obj = ((PatchCacheEntry *)[super objectForKey:key]).object;
+        expired = [self hasExpired:key];
+        hasValidators = [keyToValidatorsDictionary objectForKey:key] != nil;
+    });
+
     if (obj == nil) {
+        atomic_fetch_add(&missCount, 1);
         return nil;
     }
 
-    if ([self hasExpired:key]) {
-        [self removeObjectForKey:key];
+    // Expiry only applies to the memory tier; anything also stored on disk is still valid there. Expired objects with
+    // validators are kept so staleObjectForKey can hand them back for revalidation.
+    if (expired) {
+        if (!hasValidators) {
+            [self removeObjectFromMemoryIfExpiredForKey:key];
+        }
+        atomic_fetch_add(&missCount, 1);
         return nil;
     }
     
+    atomic_fetch_add(&hitCount, 1);
     return obj;
 }
 
+- (id)staleObjectForKey:(id)key {
+    return ((PatchCacheEntry *)[super objectForKey:key]).object;
+}
+
+- (void)setValidators:(NSDictionary *)validators forKey:(id)key {
+    dispatch_barrier_sync(bookkeepingQueue, ^{
+        if (validators == nil) {
+            [keyToValidatorsDictionary removeObjectForKey:key];
+        } else {
+            [keyToValidatorsDictionary setObject:validators forKey:key];
+        }
+    });
+}
+
+- (NSDictionary *)validatorsForKey:(id)key {
+    __block NSDictionary *validators = nil;
+    dispatch_sync(bookkeepingQueue, ^{
+        validators = [keyToValidatorsDictionary objectForKey:key];
+    });
+    return validators;
+}
+
 - (void)setObject:(id)obj forKey:(NSString *)key {
     [self setObject:obj forKey:key expire:TIME_TO_LIVE_SECONDS];
 }
 
 - (void)setObject:(id)obj forKey:(NSString *)key expire:(NSInteger)seconds {
-    [super setObject:obj forKey:key];
-    [self updateExpireKey:key expire:seconds];
+    NSDate *expireTime = [NSDate dateWithTimeIntervalSinceNow:seconds];
+
+    PatchCacheEntry *entry = [[PatchCacheEntry alloc] init];
+    entry.key = key;
+    entry.object = obj;
+    NSUInteger cost = [PatchCache costForObject:obj];
+
+    dispatch_barrier_sync(bookkeepingQueue, ^{
+        // Replacing an entry is not an eviction
+        ((PatchCacheEntry *)[super objectForKey:key]).removedExplicitly = YES;
+        [super setObject:entry forKey:key cost:cost];
+        [keyToExpireTimeDictionary setObject:expireTime forKey:key];
+    });
+}
+
+// Costs are always derived from the object itself so a caller-supplied cost is ignored.
+- (void)setObject:(id)obj forKey:(id)key cost:(NSUInteger)g {
+    [self setObject:obj forKey:key];
 }
 
+- (NSData *)dataForKey:(NSString *)key {
+    NSData *data = [self objectForKey:key];
+    if (data != nil) {
+        return data;
+    }
+
+    data = [[PatchDiskCache sharedInstance] dataForKey:key];
+    if (data != nil) {
+        [self setObject:data forKey:key];
+    }
+
+    return data;
+}
+
+- (void)setData:(NSData *)data forKey:(NSString *)key {
+    [self setObject:data forKey:key];
+    [[PatchDiskCache sharedInstance] setData:data forKey:key];
+}
+
+- (void)removeDataForKey:(NSString *)key {
+    [self removeObjectFromMemoryForKey:key];
+    [[PatchDiskCache sharedInstance] removeDataForKey:key];
+}
+
+// Lists and patch info are never persisted so this stays clear of the disk tier (and its queue); see removeDataForKey:
 - (void)removeObjectForKey:(id)key {    
-    [super removeObjectForKey:key];
-    [keyToExpireTimeDictionary removeObjectForKey:key];
+    [self removeObjectFromMemoryForKey:key];
+}
+
+- (void)removeObjectsForKeyPrefix:(NSString *)prefix {
+    // Every object in the memory tier has an expire time so that dictionary doubles as our list of keys
+    __block NSArray *keys = nil;
+    dispatch_sync(bookkeepingQueue, ^{
+        keys = [keyToExpireTimeDictionary allKeys];
+    });
+
+    for (id key in keys) {
+        if ([key isKindOfClass:[NSString class]] && [key hasPrefix:prefix]) {
+            [self removeObjectForKey:key];
+        }
+    }
+}
+
+- (void)removeObjectsContainingPatchGUID:(NSString *)guid {
+    for (id key in [self objectsContainingPatchGUID:guid]) {
+        [self removeObjectForKey:key];
+    }
+}
+
+- (NSDictionary *)objectsContainingPatchGUID:(NSString *)guid {
+    __block NSArray *keys = nil;
+    dispatch_sync(bookkeepingQueue, ^{
+        keys = [keyToExpireTimeDictionary allKeys];
+    });
+
+    NSMutableDictionary *keyToObjectDictionary = [[NSMutableDictionary alloc] init];
+    for (id key in keys) {
+        id obj = [self staleObjectForKey:key];
+        if (![obj isKindOfClass:[NSArray class]]) {
+            continue;
+        }
+
+        for (id element in obj) {
+            if ([element isKindOfClass:[Patch class]] && [((Patch *)element).guid isEqualToString:guid]) {
+                keyToObjectDictionary[key] = obj;
+                break;
+            }
+        }
+    }
+    return keyToObjectDictionary;
+}
+
+- (void)replaceObject:(id)obj forKey:(id)key {
+    PatchCacheEntry *entry = [[PatchCacheEntry alloc] init];
+    entry.key = key;
+    entry.object = obj;
+    NSUInteger cost = [PatchCache costForObject:obj];
+
+    dispatch_barrier_sync(bookkeepingQueue, ^{
+        PatchCacheEntry *existingEntry = [super objectForKey:key];
+        if (existingEntry == nil) {
+            return;
+        }
+        existingEntry.removedExplicitly = YES;
+        [super setObject:entry forKey:key cost:cost];
+    });
+}
+
+- (BOOL)replaceObject:(id)expectedObj withObject:(id)obj forKey:(id)key {
+    PatchCacheEntry *entry = [[PatchCacheEntry alloc] init];
+    entry.key = key;
+    entry.object = obj;
+    NSUInteger cost = [PatchCache costForObject:obj];
+
+    __block BOOL replaced = NO;
+    dispatch_barrier_sync(bookkeepingQueue, ^{
+        PatchCacheEntry *existingEntry = [super objectForKey:key];
+        if (existingEntry == nil || existingEntry.object != expectedObj) {
+            return;
+        }
+        existingEntry.removedExplicitly = YES;
+        [super setObject:entry forKey:key cost:cost];
+        replaced = YES;
+    });
+    return replaced;
+}
+
+- (void)removeObjectFromMemoryForKey:(id)key {
+    dispatch_barrier_sync(bookkeepingQueue, ^{
+        ((PatchCacheEntry *)[super objectForKey:key]).removedExplicitly = YES;
+        [super removeObjectForKey:key];
+        [keyToExpireTimeDictionary removeObjectForKey:key];
+        [keyToValidatorsDictionary removeObjectForKey:key];
+    });
+}
+
+// Another thread may have stored a fresh object between our expiry check and taking the write lock, so check again
+// before removing anything.
+- (void)removeObjectFromMemoryIfExpiredForKey:(id)key {
+    dispatch_barrier_sync(bookkeepingQueue, ^{
+        if ([self hasExpired:key] && [keyToValidatorsDictionary objectForKey:key] == nil) {
+            ((PatchCacheEntry *)[super objectForKey:key]).removedExplicitly = YES;
+            [super removeObjectForKey:key];
+            [keyToExpireTimeDictionary removeObjectForKey:key];
+        }
+    });
 }
 
 - (void)removeAllObjects {
-    [super removeAllObjects];
-    [keyToExpireTimeDictionary removeAllObjects];
+    dispatch_barrier_sync(bookkeepingQueue, ^{
+        removingAllObjects = YES;
+        [super removeAllObjects];
+        removingAllObjects = NO;
+        [keyToExpireTimeDictionary removeAllObjects];
+        [keyToValidatorsDictionary removeAllObjects];
+    });
 }
 
-- (void)updateExpireKey:(NSString *)key expire:(NSInteger)seconds {
-    [keyToExpireTimeDictionary setObject:[NSDate dateWithTimeIntervalSinceNow:seconds] forKey:key];
+- (void)removeAllObjectsAndData {
+    [self removeAllObjects];
+    [[PatchDiskCache sharedInstance] removeAllData];
+}
+
+#pragma mark - NSCacheDelegate
+
+// NSCache calls this for our own removals too, so only entries we did not flag (and that are not part of a
+// removeAllObjects call) count as evictions. This can be called while a barrier block above is running on the same
+// thread so bookkeeping cleanup is dispatched asynchronously rather than with dispatch_barrier_sync.
+- (void)cache:(NSCache *)cache willEvictObject:(id)obj {
+    PatchCacheEntry *entry = obj;
+    if (entry.removedExplicitly || removingAllObjects) {
+        return;
+    }
+
+    atomic_fetch_add(&evictionCount, 1);
+
+    dispatch_barrier_async(bookkeepingQueue, ^{
+        // Only clean up if nothing newer has been stored under the same key in the meantime
+        if ([super objectForKey:entry.key] == nil) {
+            [keyToExpireTimeDictionary removeObjectForKey:entry.key];
+            [keyToValidatorsDictionary removeObjectForKey:entry.key];
+        }
+    });
+}
+
+#pragma mark - Statistics
+
+- (NSUInteger)hitCount {
+    return atomic_load(&hitCount);
+}
+
+- (NSUInteger)missCount {
+    return atomic_load(&missCount);
+}
+
+- (NSUInteger)evictionCount {
+    return atomic_load(&evictionCount);
+}
+
+- (void)resetStatistics {
+    atomic_store(&hitCount, 0);
+    atomic_store(&missCount, 0);
+    atomic_store(&evictionCount, 0);
+}
+
+#pragma mark - Cost Estimation
+
++ (NSUInteger)costForObject:(id)obj {
+    if ([obj isKindOfClass:[NSData class]]) {
+        return [obj length];
+    }
+
+    if ([obj isKindOfClass:[NSArray class]]) {
+        NSUInteger cost = OBJECT_OVERHEAD_COST;
+        for (id element in obj) {
+            cost += [PatchCache costForObject:element];
+        }
+        return cost;
+    }
+
+    if ([obj isKindOfClass:[Patch class]]) {
+        Patch *patch = obj;
+        return OBJECT_OVERHEAD_COST + [PatchCache costForStrings:@[patch.guid ?: @"", patch.name ?: @"", patch.patchDescription ?: @"",
+                                                                   patch.parentGUID ?: @"", patch.creatorUsername ?: @"",
+                                                                   patch.resourceUrl ?: @"", patch.extraResourceUrl ?: @""]];
+    }
+
+    if ([obj isKindOfClass:[LiveSession class]]) {
+        LiveSession *liveSession = obj;
+        return OBJECT_OVERHEAD_COST + [liveSession.sessionData length] +
+               [PatchCache costForStrings:@[liveSession.sessionGUID ?: @"", liveSession.sessionTitle ?: @"", liveSession.creatorUsername ?: @""]];
+    }
+
+    return OBJECT_OVERHEAD_COST;
+}
+
++ (NSUInteger)costForStrings:(NSArray *)strings {
+    NSUInteger cost = 0;
+    for (NSString *string in strings) {
+        cost += OBJECT_OVERHEAD_COST + [string length] * sizeof(unichar);
+    }
+    return cost;
 }
 
+// Must be called on bookkeepingQueue. A key without an expire time is treated as expired.
 - (BOOL)hasExpired:(NSString *)key {
-    return [[NSDate date] timeIntervalSinceDate:[keyToExpireTimeDictionary objectForKey:key]] > 0;
+    NSDate *expireTime = [keyToExpireTimeDictionary objectForKey:key];
+    return expireTime == nil || [expireTime timeIntervalSinceNow] < 0;
 }
 
-@end
\ No newline at end of file
+@end
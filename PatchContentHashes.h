@@ -0,0 +1,33 @@
+//
+//  PatchContentHashes.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Remembers the SHA-256 of the data parts (patch data and extra data) of the revision of each patch we last uploaded
+//  or downloaded, so updatePatch can leave out parts whose bytes have not changed. Hashes are tied to the revision they
+//  were recorded for and are only returned for a Patch carrying that revision. A Patch object fetched before the patch
+//  was edited elsewhere still carries the old revision, so this alone cannot tell that the stored bytes have moved on;
+//  updatePatch therefore sends the hash of every part it leaves out so the service can reject the update if its copy
+//  differs. Hashes are kept for a bounded number of recently used patches and persisted in the caches directory so
+//  they survive app restarts.
+
+#import <Foundation/Foundation.h>
+
+@interface PatchContentHashes : NSObject
+
++ (PatchContentHashes *)sharedInstance;
+
+// Lowercase hex SHA-256 of data.
++ (NSString *)SHA256HexDigestForData:(NSData *)data;
+
+// Returns the hash recorded for part (the part's form field name) of the patch with guid, or nil if none was recorded
+// for this revision.
+- (NSString *)hashForPart:(NSString *)part ofPatchWithGUID:(NSString *)guid revision:(NSInteger)revision;
+
+// Records hash for part. Hashes recorded for other parts are kept if they belong to the same revision and dropped
+// otherwise. A nil hash forgets the part.
+- (void)setHash:(NSString *)hash forPart:(NSString *)part ofPatchWithGUID:(NSString *)guid revision:(NSInteger)revision;
+
+- (void)removeHashesForPatchWithGUID:(NSString *)guid;
+
+@end
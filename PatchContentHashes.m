@@ -0,0 +1,149 @@
+//
+//  PatchContentHashes.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+
+#import "PatchContentHashes.h"
+
+#include <CommonCrypto/CommonDigest.h>
+
+static NSString *const CONTENT_HASHES_FILE_NAME = @"chuckpad-social-content-hashes.plist";
+
+// Entry keys; every other key in an entry is a part name
+static NSString *const ENTRY_REVISION = @"revision";
+static NSString *const ENTRY_ACCESSED = @"accessed";
+
+// Hashes are kept for at most this many patches; the least recently used ones are dropped first.
+static const NSUInteger CONTENT_HASHES_MAX_PATCHES = 2000;
+
+// Changes are batched so a burst of uploads or downloads results in a single write of the file.
+static const int64_t WRITE_DELAY_SECONDS = 2;
+
+@implementation PatchContentHashes {
+    @private NSString *filePath;
+    @private NSMutableDictionary *guidToEntryDictionary;
+    @private BOOL writeScheduled;
+}
+
++ (PatchContentHashes *)sharedInstance {
+    static PatchContentHashes *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedInstance = [[PatchContentHashes alloc] init];
+    });
+    return sharedInstance;
+}
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+        filePath = [cachesPath stringByAppendingPathComponent:CONTENT_HASHES_FILE_NAME];
+
+        guidToEntryDictionary = [[NSMutableDictionary alloc] init];
+        NSDictionary *persistedEntries = [NSDictionary dictionaryWithContentsOfFile:filePath];
+        for (NSString *guid in persistedEntries) {
+            guidToEntryDictionary[guid] = [persistedEntries[guid] mutableCopy];
+        }
+    }
+    return self;
+}
+
++ (NSString *)SHA256HexDigestForData:(NSData *)data {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG)data.length, digest);
+
+    NSMutableString *hexDigestString = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (NSInteger i = 0; i < CC_SHA256_DIGEST_LENGTH; ++i) {
+        [hexDigestString appendFormat:@"%02x", digest[i]];
+    }
+    return hexDigestString;
+}
+
+- (NSString *)hashForPart:(NSString *)part ofPatchWithGUID:(NSString *)guid revision:(NSInteger)revision {
+    if (guid == nil) {
+        return nil;
+    }
+
+    @synchronized (self) {
+        NSMutableDictionary *entry = guidToEntryDictionary[guid];
+        if ([entry[ENTRY_REVISION] integerValue] != revision) {
+            return nil;
+        }
+
+        entry[ENTRY_ACCESSED] = @([[NSDate date] timeIntervalSince1970]);
+        [self scheduleWrite];
+        return entry[part];
+    }
+}
+
+- (void)setHash:(NSString *)hash forPart:(NSString *)part ofPatchWithGUID:(NSString *)guid revision:(NSInteger)revision {
+    if (guid == nil) {
+        return;
+    }
+
+    @synchronized (self) {
+        NSMutableDictionary *entry = guidToEntryDictionary[guid];
+        if (entry == nil || [entry[ENTRY_REVISION] integerValue] != revision) {
+            entry = [@{ ENTRY_REVISION : @(revision) } mutableCopy];
+            guidToEntryDictionary[guid] = entry;
+        }
+
+        entry[ENTRY_ACCESSED] = @([[NSDate date] timeIntervalSince1970]);
+        entry[part] = hash;
+        [self evictIfNeeded];
+        [self scheduleWrite];
+    }
+}
+
+- (void)removeHashesForPatchWithGUID:(NSString *)guid {
+    if (guid == nil) {
+        return;
+    }
+
+    @synchronized (self) {
+        if (guidToEntryDictionary[guid] != nil) {
+            [guidToEntryDictionary removeObjectForKey:guid];
+            [self scheduleWrite];
+        }
+    }
+}
+
+// Entries persisted before access times were recorded count as the oldest
+- (void)evictIfNeeded {
+    if ([guidToEntryDictionary count] <= CONTENT_HASHES_MAX_PATCHES) {
+        return;
+    }
+
+    NSArray *guidsByAccessTime = [guidToEntryDictionary keysSortedByValueUsingComparator:^NSComparisonResult(id first, id second) {
+        return [@([first[ENTRY_ACCESSED] doubleValue]) compare:@([second[ENTRY_ACCESSED] doubleValue])];
+    }];
+
+    NSUInteger evictCount = [guidToEntryDictionary count] - CONTENT_HASHES_MAX_PATCHES;
+    [guidToEntryDictionary removeObjectsForKeys:[guidsByAccessTime subarrayWithRange:NSMakeRange(0, evictCount)]];
+}
+
+// Must be called while synchronized on self
+- (void)scheduleWrite {
+    if (writeScheduled) {
+        return;
+    }
+
+    writeScheduled = YES;
+    dispatch_queue_t writeQueue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, WRITE_DELAY_SECONDS * NSEC_PER_SEC), writeQueue, ^{
+        @synchronized (self) {
+            [self writeEntries];
+        }
+    });
+}
+
+- (void)writeEntries {
+    writeScheduled = NO;
+    if (![guidToEntryDictionary writeToFile:filePath atomically:YES]) {
+        NSLog(@"PatchContentHashes - failed to write %@", filePath);
+    }
+}
+
+@end
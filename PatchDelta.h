@@ -0,0 +1,26 @@
+//
+//  PatchDelta.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Binary deltas between two revisions of patch data. Consecutive revisions of a ChucK script usually differ by a few
+//  lines, so a delta against the previous revision is a small fraction of the new revision's size.
+//
+//  Format (all integers are unsigned LEB128 varints):
+//      "CPD1" <base length> <target length> followed by operations until the end of the data:
+//      0x01 <length> <bytes>       - append the literal bytes that follow
+//      0x02 <offset> <length>      - append length bytes of the base starting at offset
+
+#import <Foundation/Foundation.h>
+
+@interface PatchDelta : NSObject
+
+// Returns a delta that turns base into target. Matches are found between blocks of base and any position in target
+// (the rsync approach) so insertions, deletions and moved blocks are all encoded compactly.
++ (NSData *)deltaFromData:(NSData *)base toData:(NSData *)target;
+
+// Reconstructs the target from base and a delta made by deltaFromData. Returns nil if the delta is malformed or was
+// not made against data of base's length.
++ (NSData *)dataByApplyingDelta:(NSData *)delta toData:(NSData *)base;
+
+@end
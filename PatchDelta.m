@@ -0,0 +1,220 @@
+//
+//  PatchDelta.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  The base is cut into BLOCK_SIZE byte blocks which are indexed by a rolling hash. The hash then slides over the
+//  target one byte at a time; wherever it lands on a block of the base (confirmed with memcmp) the match is grown in
+//  both directions and emitted as a copy. Everything between matches is emitted as literal bytes.
+
+#import "PatchDelta.h"
+
+static const char DELTA_MAGIC[4] = { 'C', 'P', 'D', '1' };
+
+static const uint8_t DELTA_OP_LITERAL = 0x01;
+static const uint8_t DELTA_OP_COPY = 0x02;
+
+// Small enough to match around a one line edit of a script, large enough that a copy is cheaper than its literal
+static const NSUInteger BLOCK_SIZE = 16;
+
+static const uint32_t ROLLING_HASH_BASE = 257;
+
+static void appendVarint(NSMutableData *data, uint64_t value) {
+    uint8_t buffer[10];
+    NSUInteger length = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        buffer[length++] = value != 0 ? (byte | 0x80) : byte;
+    } while (value != 0);
+    [data appendBytes:buffer length:length];
+}
+
+static BOOL readVarint(const uint8_t *bytes, NSUInteger length, NSUInteger *position, uint64_t *value) {
+    uint64_t result = 0;
+    for (NSUInteger shift = 0; shift < 64; shift += 7) {
+        if (*position >= length) {
+            return NO;
+        }
+        uint8_t byte = bytes[(*position)++];
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+static void appendLiteral(NSMutableData *delta, const uint8_t *bytes, NSUInteger length) {
+    if (length == 0) {
+        return;
+    }
+    [delta appendBytes:&DELTA_OP_LITERAL length:1];
+    appendVarint(delta, length);
+    [delta appendBytes:bytes length:length];
+}
+
+static void appendCopy(NSMutableData *delta, NSUInteger offset, NSUInteger length) {
+    [delta appendBytes:&DELTA_OP_COPY length:1];
+    appendVarint(delta, offset);
+    appendVarint(delta, length);
+}
+
+static uint32_t blockHash(const uint8_t *bytes) {
+    uint32_t hash = 0;
+    for (NSUInteger i = 0; i < BLOCK_SIZE; i++) {
+        hash = hash * ROLLING_HASH_BASE + bytes[i];
+    }
+    return hash;
+}
+
+static NSUInteger slotForHash(uint32_t hash, NSUInteger mask) {
+    return (hash * 2654435761u) & mask;
+}
+
+@implementation PatchDelta
+
++ (NSData *)deltaFromData:(NSData *)base toData:(NSData *)target {
+    const uint8_t *baseBytes = base.bytes;
+    const uint8_t *targetBytes = target.bytes;
+    NSUInteger baseLength = base.length;
+    NSUInteger targetLength = target.length;
+
+    NSMutableData *delta = [NSMutableData dataWithBytes:DELTA_MAGIC length:sizeof(DELTA_MAGIC)];
+    appendVarint(delta, baseLength);
+    appendVarint(delta, targetLength);
+
+    if (baseLength < BLOCK_SIZE || targetLength < BLOCK_SIZE) {
+        appendLiteral(delta, targetBytes, targetLength);
+        return delta;
+    }
+
+    // Open addressing table from block hash to the offset of the first base block with that hash. Offsets are stored
+    // plus one so zero marks an empty slot.
+    NSUInteger blockCount = baseLength / BLOCK_SIZE;
+    NSUInteger tableSize = 1;
+    while (tableSize < blockCount * 2) {
+        tableSize <<= 1;
+    }
+    NSUInteger mask = tableSize - 1;
+    NSMutableData *hashesData = [NSMutableData dataWithLength:tableSize * sizeof(uint32_t)];
+    NSMutableData *offsetsData = [NSMutableData dataWithLength:tableSize * sizeof(NSUInteger)];
+    uint32_t *hashes = hashesData.mutableBytes;
+    NSUInteger *offsets = offsetsData.mutableBytes;
+
+    for (NSUInteger offset = 0; offset + BLOCK_SIZE <= baseLength; offset += BLOCK_SIZE) {
+        uint32_t hash = blockHash(baseBytes + offset);
+        NSUInteger slot = slotForHash(hash, mask);
+        while (offsets[slot] != 0 && hashes[slot] != hash) {
+            slot = (slot + 1) & mask;
+        }
+        if (offsets[slot] == 0) {
+            hashes[slot] = hash;
+            offsets[slot] = offset + 1;
+        }
+    }
+
+    // Weight of the byte leaving the window when the hash rolls forward
+    uint32_t outgoingWeight = 1;
+    for (NSUInteger i = 1; i < BLOCK_SIZE; i++) {
+        outgoingWeight *= ROLLING_HASH_BASE;
+    }
+
+    NSUInteger literalStart = 0;
+    NSUInteger position = 0;
+    uint32_t hash = blockHash(targetBytes);
+
+    while (position + BLOCK_SIZE <= targetLength) {
+        NSUInteger slot = slotForHash(hash, mask);
+        while (offsets[slot] != 0 && hashes[slot] != hash) {
+            slot = (slot + 1) & mask;
+        }
+
+        if (offsets[slot] != 0 && memcmp(baseBytes + offsets[slot] - 1, targetBytes + position, BLOCK_SIZE) == 0) {
+            NSUInteger matchBase = offsets[slot] - 1;
+            NSUInteger matchTarget = position;
+            NSUInteger matchLength = BLOCK_SIZE;
+
+            while (matchBase + matchLength < baseLength && matchTarget + matchLength < targetLength &&
+                   baseBytes[matchBase + matchLength] == targetBytes[matchTarget + matchLength]) {
+                matchLength++;
+            }
+            while (matchBase > 0 && matchTarget > literalStart && baseBytes[matchBase - 1] == targetBytes[matchTarget - 1]) {
+                matchBase--;
+                matchTarget--;
+                matchLength++;
+            }
+
+            appendLiteral(delta, targetBytes + literalStart, matchTarget - literalStart);
+            appendCopy(delta, matchBase, matchLength);
+
+            position = matchTarget + matchLength;
+            literalStart = position;
+            if (position + BLOCK_SIZE <= targetLength) {
+                hash = blockHash(targetBytes + position);
+            }
+            continue;
+        }
+
+        if (position + BLOCK_SIZE < targetLength) {
+            hash = (hash - targetBytes[position] * outgoingWeight) * ROLLING_HASH_BASE + targetBytes[position + BLOCK_SIZE];
+        }
+        position++;
+    }
+
+    appendLiteral(delta, targetBytes + literalStart, targetLength - literalStart);
+    return delta;
+}
+
++ (NSData *)dataByApplyingDelta:(NSData *)delta toData:(NSData *)base {
+    const uint8_t *deltaBytes = delta.bytes;
+    NSUInteger deltaLength = delta.length;
+    NSUInteger position = sizeof(DELTA_MAGIC);
+
+    if (deltaLength < sizeof(DELTA_MAGIC) || memcmp(deltaBytes, DELTA_MAGIC, sizeof(DELTA_MAGIC)) != 0) {
+        return nil;
+    }
+
+    uint64_t baseLength;
+    uint64_t targetLength;
+    if (!readVarint(deltaBytes, deltaLength, &position, &baseLength) ||
+        !readVarint(deltaBytes, deltaLength, &position, &targetLength) || baseLength != base.length) {
+        return nil;
+    }
+
+    // A copy op can repeat any part of base so targetLength has no useful upper bound. It comes from the delta itself
+    // though, so it only sizes the initial buffer up to the size of the inputs and the buffer grows from there.
+    NSMutableData *target = [NSMutableData dataWithCapacity:(NSUInteger)MIN(targetLength, (uint64_t)deltaLength + baseLength)];
+    while (position < deltaLength) {
+        uint8_t op = deltaBytes[position++];
+        uint64_t offset = 0;
+        uint64_t length;
+
+        if (op == DELTA_OP_COPY && !readVarint(deltaBytes, deltaLength, &position, &offset)) {
+            return nil;
+        }
+        if (!readVarint(deltaBytes, deltaLength, &position, &length) || target.length + length > targetLength) {
+            return nil;
+        }
+
+        if (op == DELTA_OP_LITERAL) {
+            if (length > deltaLength - position) {
+                return nil;
+            }
+            [target appendBytes:deltaBytes + position length:(NSUInteger)length];
+            position += length;
+        } else if (op == DELTA_OP_COPY) {
+            if (offset > baseLength || length > baseLength - offset) {
+                return nil;
+            }
+            [target appendBytes:(const uint8_t *)base.bytes + offset length:(NSUInteger)length];
+        } else {
+            return nil;
+        }
+    }
+
+    return target.length == targetLength ? target : nil;
+}
+
+@end
@@ -0,0 +1,55 @@
+//
+//  PatchDiskCache.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Persistent disk tier that sits underneath PatchCache. Blobs are stored content-addressed (file name is the SHA-256
+//  of the bytes) so identical resources stored under different keys share one file. A small index maps cache keys to
+//  blobs and tracks last access time so the least recently used entries are evicted once the byte limit is exceeded.
+//  The index is persisted so entries survive app restarts.
+
+#import <Foundation/Foundation.h>
+
+// If no byte limit is specified, this default will be used.
+extern const NSUInteger DISK_CACHE_BYTE_LIMIT;
+
+@interface PatchDiskCache : NSObject
+
++ (PatchDiskCache *)sharedInstance;
+
+// Maximum number of bytes of blob data kept on disk. Lowering this evicts immediately.
+@property(nonatomic, assign) NSUInteger byteLimit;
+
+// Reads the blob from disk before returning so avoid calling this on the main thread.
+- (NSData *)dataForKey:(NSString *)key;
+
+// Whether data is stored for key. Unlike dataForKey this does not read the blob or count as an access.
+- (BOOL)containsDataForKey:(NSString *)key;
+
+// Returns right away; the blob is hashed and written on the cache's own queue.
+- (void)setData:(NSData *)data forKey:(NSString *)key;
+
+- (void)removeDataForKey:(NSString *)key;
+
+- (void)removeAllData;
+
+// Keys of all entries currently stored whose key starts with prefix, in no particular order. Unlike dataForKey this
+// does not touch the blobs or count as an access.
+- (NSArray *)keysWithPrefix:(NSString *)prefix;
+
+// Number of bytes of blob data currently stored on disk.
+- (NSUInteger)totalBytes;
+
+// Partially downloaded data lives in its own directory so an interrupted download can later be resumed with an HTTP
+// Range request. It does not count towards byteLimit and the owner removes it once the download completes. The
+// validators (ETag/Last-Modified) of the response the bytes came from are kept alongside so a resumed request can
+// check that the resource has not changed in the meantime.
+- (NSString *)partialDataPathForKey:(NSString *)key;
+
+- (NSDictionary *)partialDataValidatorsForKey:(NSString *)key;
+
+- (void)setPartialDataValidators:(NSDictionary *)validators forKey:(NSString *)key;
+
+- (void)removePartialDataForKey:(NSString *)key;
+
+@end
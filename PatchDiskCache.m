@@ -0,0 +1,318 @@
+//
+//  PatchDiskCache.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+
+#import "PatchDiskCache.h"
+
+#import "PatchContentHashes.h"
+
+// Default disk budget is 50 MB
+NSUInteger const DISK_CACHE_BYTE_LIMIT = 50 * 1024 * 1024;
+
+static NSString *const DISK_CACHE_DIRECTORY_NAME = @"chuckpad-social-cache";
+static NSString *const DISK_CACHE_BLOBS_DIRECTORY_NAME = @"blobs";
+static NSString *const DISK_CACHE_PARTIAL_DIRECTORY_NAME = @"partial";
+static NSString *const DISK_CACHE_PARTIAL_VALIDATORS_EXTENSION = @"validators";
+static NSString *const DISK_CACHE_INDEX_FILE_NAME = @"index.plist";
+
+// Index entry keys
+static NSString *const INDEX_ENTRY_HASH = @"hash";
+static NSString *const INDEX_ENTRY_SIZE = @"size";
+static NSString *const INDEX_ENTRY_ACCESSED = @"accessed";
+
+// Access time updates are batched so a burst of cache hits results in a single index write.
+static const int64_t INDEX_WRITE_DELAY_SECONDS = 2;
+
+@implementation PatchDiskCache {
+    @private dispatch_queue_t queue;
+    @private NSString *blobsPath;
+    @private NSString *partialPath;
+    @private NSString *indexPath;
+    @private NSMutableDictionary *keyToEntryDictionary;
+    @private NSCountedSet *blobHashes;
+    @private NSUInteger storedBytes;
+    @private BOOL indexWriteScheduled;
+}
+
++ (PatchDiskCache *)sharedInstance {
+    static PatchDiskCache *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedInstance = [[PatchDiskCache alloc] init];
+    });
+    return sharedInstance;
+}
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        queue = dispatch_queue_create("chuckpad-social.disk-cache", DISPATCH_QUEUE_SERIAL);
+
+        NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+        NSString *rootPath = [cachesPath stringByAppendingPathComponent:DISK_CACHE_DIRECTORY_NAME];
+        blobsPath = [rootPath stringByAppendingPathComponent:DISK_CACHE_BLOBS_DIRECTORY_NAME];
+        partialPath = [rootPath stringByAppendingPathComponent:DISK_CACHE_PARTIAL_DIRECTORY_NAME];
+        indexPath = [rootPath stringByAppendingPathComponent:DISK_CACHE_INDEX_FILE_NAME];
+
+        _byteLimit = DISK_CACHE_BYTE_LIMIT;
+
+        [[NSFileManager defaultManager] createDirectoryAtPath:blobsPath withIntermediateDirectories:YES attributes:nil error:nil];
+        [[NSFileManager defaultManager] createDirectoryAtPath:partialPath withIntermediateDirectories:YES attributes:nil error:nil];
+        [self loadIndex];
+    }
+    return self;
+}
+
+- (void)setByteLimit:(NSUInteger)byteLimit {
+    dispatch_sync(queue, ^{
+        _byteLimit = byteLimit;
+        [self evictIfNeeded];
+    });
+}
+
+- (NSData *)dataForKey:(NSString *)key {
+    if (key == nil) {
+        return nil;
+    }
+
+    __block NSData *data = nil;
+    dispatch_sync(queue, ^{
+        NSMutableDictionary *entry = keyToEntryDictionary[key];
+        if (entry == nil) {
+            return;
+        }
+
+        data = [NSData dataWithContentsOfFile:[self pathForHash:entry[INDEX_ENTRY_HASH]]];
+        if (data == nil) {
+            // Blob went missing underneath us (e.g. the OS purged the caches directory); drop the stale entry
+            [self removeEntryForKey:key];
+            [self scheduleIndexWrite];
+            return;
+        }
+
+        entry[INDEX_ENTRY_ACCESSED] = @([[NSDate date] timeIntervalSince1970]);
+        [self scheduleIndexWrite];
+    });
+    return data;
+}
+
+- (BOOL)containsDataForKey:(NSString *)key {
+    if (key == nil) {
+        return NO;
+    }
+
+    __block BOOL contains;
+    dispatch_sync(queue, ^{
+        contains = keyToEntryDictionary[key] != nil;
+    });
+    return contains;
+}
+
+- (void)setData:(NSData *)data forKey:(NSString *)key {
+    if (data == nil || key == nil) {
+        return;
+    }
+
+    // Hashing and writing a blob of several MB should not hold up the caller. Every other call goes through the same
+    // serial queue so it still sees the data once this returns.
+    NSData *dataCopy = [data copy];
+    dispatch_async(queue, ^{
+        NSString *hash = [PatchContentHashes SHA256HexDigestForData:dataCopy];
+
+        // Re-storing identical bytes under the same key only needs an access time bump
+        NSMutableDictionary *existingEntry = keyToEntryDictionary[key];
+        if (existingEntry != nil && ![existingEntry[INDEX_ENTRY_HASH] isEqualToString:hash]) {
+            [self removeEntryForKey:key];
+        }
+
+        if ([blobHashes countForObject:hash] == 0) {
+            if (![dataCopy writeToFile:[self pathForHash:hash] atomically:YES]) {
+                NSLog(@"PatchDiskCache - failed to write blob for key %@", key);
+                return;
+            }
+            storedBytes += dataCopy.length;
+        }
+
+        if (keyToEntryDictionary[key] == nil) {
+            [blobHashes addObject:hash];
+        }
+
+        keyToEntryDictionary[key] = [@{ INDEX_ENTRY_HASH : hash,
+                                        INDEX_ENTRY_SIZE : @(dataCopy.length),
+                                        INDEX_ENTRY_ACCESSED : @([[NSDate date] timeIntervalSince1970]) } mutableCopy];
+
+        [self evictIfNeeded];
+        [self scheduleIndexWrite];
+    });
+}
+
+- (void)removeDataForKey:(NSString *)key {
+    if (key == nil) {
+        return;
+    }
+
+    dispatch_sync(queue, ^{
+        [self removeEntryForKey:key];
+        [self scheduleIndexWrite];
+    });
+}
+
+- (void)removeAllData {
+    dispatch_sync(queue, ^{
+        for (NSString *hash in blobHashes) {
+            [[NSFileManager defaultManager] removeItemAtPath:[self pathForHash:hash] error:nil];
+        }
+
+        [keyToEntryDictionary removeAllObjects];
+        [blobHashes removeAllObjects];
+        storedBytes = 0;
+
+        [self writeIndex];
+
+        [[NSFileManager defaultManager] removeItemAtPath:partialPath error:nil];
+        [[NSFileManager defaultManager] createDirectoryAtPath:partialPath withIntermediateDirectories:YES attributes:nil error:nil];
+    });
+}
+
+- (NSArray *)keysWithPrefix:(NSString *)prefix {
+    NSMutableArray *keys = [[NSMutableArray alloc] init];
+    dispatch_sync(queue, ^{
+        for (NSString *key in keyToEntryDictionary) {
+            if ([key hasPrefix:prefix]) {
+                [keys addObject:key];
+            }
+        }
+    });
+    return keys;
+}
+
+- (NSUInteger)totalBytes {
+    __block NSUInteger bytes;
+    dispatch_sync(queue, ^{
+        bytes = storedBytes;
+    });
+    return bytes;
+}
+
+#pragma mark - Partial Data
+
+// Partial data is only ever touched by the single download in flight for its key so these do not go through queue.
+- (NSString *)partialDataPathForKey:(NSString *)key {
+    return [partialPath stringByAppendingPathComponent:[PatchContentHashes SHA256HexDigestForData:[key dataUsingEncoding:NSUTF8StringEncoding]]];
+}
+
+- (NSDictionary *)partialDataValidatorsForKey:(NSString *)key {
+    return [NSDictionary dictionaryWithContentsOfFile:[self partialDataValidatorsPathForKey:key]];
+}
+
+- (void)setPartialDataValidators:(NSDictionary *)validators forKey:(NSString *)key {
+    if (validators == nil) {
+        [[NSFileManager defaultManager] removeItemAtPath:[self partialDataValidatorsPathForKey:key] error:nil];
+    } else {
+        [validators writeToFile:[self partialDataValidatorsPathForKey:key] atomically:YES];
+    }
+}
+
+- (void)removePartialDataForKey:(NSString *)key {
+    [[NSFileManager defaultManager] removeItemAtPath:[self partialDataPathForKey:key] error:nil];
+    [[NSFileManager defaultManager] removeItemAtPath:[self partialDataValidatorsPathForKey:key] error:nil];
+}
+
+- (NSString *)partialDataValidatorsPathForKey:(NSString *)key {
+    return [[self partialDataPathForKey:key] stringByAppendingPathExtension:DISK_CACHE_PARTIAL_VALIDATORS_EXTENSION];
+}
+
+#pragma mark - Private (must be called on queue)
+
+- (void)removeEntryForKey:(NSString *)key {
+    NSDictionary *entry = keyToEntryDictionary[key];
+    if (entry == nil) {
+        return;
+    }
+
+    NSString *hash = entry[INDEX_ENTRY_HASH];
+    [keyToEntryDictionary removeObjectForKey:key];
+    [blobHashes removeObject:hash];
+
+    // Only delete the blob once no other key references the same content
+    if ([blobHashes countForObject:hash] == 0) {
+        [[NSFileManager defaultManager] removeItemAtPath:[self pathForHash:hash] error:nil];
+        storedBytes -= MIN(storedBytes, [entry[INDEX_ENTRY_SIZE] unsignedIntegerValue]);
+    }
+}
+
+- (void)evictIfNeeded {
+    if (storedBytes <= _byteLimit) {
+        return;
+    }
+
+    NSArray *keysByAccessTime = [keyToEntryDictionary keysSortedByValueUsingComparator:^NSComparisonResult(id first, id second) {
+        return [first[INDEX_ENTRY_ACCESSED] compare:second[INDEX_ENTRY_ACCESSED]];
+    }];
+
+    for (NSString *key in keysByAccessTime) {
+        if (storedBytes <= _byteLimit) {
+            break;
+        }
+        NSLog(@"PatchDiskCache - evicting %@", key);
+        [self removeEntryForKey:key];
+    }
+}
+
+- (void)loadIndex {
+    keyToEntryDictionary = [[NSMutableDictionary alloc] init];
+    blobHashes = [[NSCountedSet alloc] init];
+    storedBytes = 0;
+
+    NSDictionary *persistedIndex = [NSDictionary dictionaryWithContentsOfFile:indexPath];
+    for (NSString *key in persistedIndex) {
+        NSDictionary *entry = persistedIndex[key];
+        NSString *hash = entry[INDEX_ENTRY_HASH];
+
+        // Skip entries whose blob no longer exists on disk
+        if (hash == nil || ![[NSFileManager defaultManager] fileExistsAtPath:[self pathForHash:hash]]) {
+            continue;
+        }
+
+        if ([blobHashes countForObject:hash] == 0) {
+            storedBytes += [entry[INDEX_ENTRY_SIZE] unsignedIntegerValue];
+        }
+
+        [blobHashes addObject:hash];
+        keyToEntryDictionary[key] = [entry mutableCopy];
+    }
+
+    // A blob is written as soon as it is stored but the index only a little later, so the app being killed in between
+    // leaves a blob no entry refers to. Nothing would ever count or evict it so it is deleted here.
+    for (NSString *fileName in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:blobsPath error:nil]) {
+        if ([blobHashes countForObject:fileName] == 0) {
+            [[NSFileManager defaultManager] removeItemAtPath:[self pathForHash:fileName] error:nil];
+        }
+    }
+}
+
+- (void)scheduleIndexWrite {
+    if (indexWriteScheduled) {
+        return;
+    }
+
+    indexWriteScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, INDEX_WRITE_DELAY_SECONDS * NSEC_PER_SEC), queue, ^{
+        [self writeIndex];
+    });
+}
+
+- (void)writeIndex {
+    indexWriteScheduled = NO;
+    if (![keyToEntryDictionary writeToFile:indexPath atomically:YES]) {
+        NSLog(@"PatchDiskCache - failed to write index");
+    }
+}
+
+- (NSString *)pathForHash:(NSString *)hash {
+    return [blobsPath stringByAppendingPathComponent:hash];
+}
+
+@end
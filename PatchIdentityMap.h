@@ -0,0 +1,29 @@
+//
+//  PatchIdentityMap.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Keeps one Patch instance per GUID. Every list (featured, recent, world, per user, ...) and every single-patch call
+//  hands out the same instance for a given patch, so a patch that shows up in several lists only exists once in memory
+//  and changes to it (e.g. from updatePatch) show up everywhere it is referenced. Patches are held weakly; once nothing
+//  else references a patch it is dropped from the map.
+
+#import <Foundation/Foundation.h>
+
+@class Patch;
+
+@interface PatchIdentityMap : NSObject
+
++ (PatchIdentityMap *)sharedInstance;
+
+// Returns the Patch for the GUID in dictionary. If one already exists it is updated in place with the values in
+// dictionary unless none of them changed, otherwise a new one is created. See Patch's updateWithDictionary for when
+// it is safe to read a shared patch.
+- (Patch *)patchForDictionary:(NSDictionary *)dictionary;
+
+// Returns the Patch for guid if one is currently alive, nil otherwise.
+- (Patch *)patchForGUID:(NSString *)guid;
+
+- (void)removePatchForGUID:(NSString *)guid;
+
+@end
@@ -0,0 +1,75 @@
+//
+//  PatchIdentityMap.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+
+#import "PatchIdentityMap.h"
+
+#import "Patch.h"
+
+@implementation PatchIdentityMap {
+    @private NSMapTable *guidToPatchMapTable;
+}
+
++ (PatchIdentityMap *)sharedInstance {
+    static PatchIdentityMap *sharedInstance = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        sharedInstance = [[PatchIdentityMap alloc] init];
+    });
+    return sharedInstance;
+}
+
+- (id)init {
+    self = [super init];
+    if (self) {
+        guidToPatchMapTable = [NSMapTable strongToWeakObjectsMapTable];
+    }
+    return self;
+}
+
+// Called concurrently from ChuckPadSocial's processing queue for regular list calls and from the streaming session's
+// delegate queue for progressive ones, hence the lock.
+- (Patch *)patchForDictionary:(NSDictionary *)dictionary {
+    NSString *guid = dictionary[@"guid"];
+    if (![guid isKindOfClass:[NSString class]]) {
+        return [[Patch alloc] initWithDictionary:dictionary];
+    }
+
+    @synchronized (self) {
+        Patch *patch = [guidToPatchMapTable objectForKey:guid];
+        if (patch != nil) {
+            if (![patch isUpToDateWithDictionary:dictionary]) {
+                [patch updateWithDictionary:dictionary];
+            }
+            return patch;
+        }
+
+        patch = [[Patch alloc] initWithDictionary:dictionary];
+        [guidToPatchMapTable setObject:patch forKey:guid];
+        return patch;
+    }
+}
+
+- (Patch *)patchForGUID:(NSString *)guid {
+    if (guid == nil) {
+        return nil;
+    }
+
+    @synchronized (self) {
+        return [guidToPatchMapTable objectForKey:guid];
+    }
+}
+
+- (void)removePatchForGUID:(NSString *)guid {
+    if (guid == nil) {
+        return;
+    }
+
+    @synchronized (self) {
+        [guidToPatchMapTable removeObjectForKey:guid];
+    }
+}
+
+@end
@@ -0,0 +1,43 @@
+//
+//  PatchListStreamParser.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Incremental parser for patch list responses. Bytes are fed in as they arrive off the network and Patch objects are
+//  handed out in batches as soon as each one is complete, so only the patches in the current batch (not the whole
+//  list of dictionaries) are held in memory at once. ChuckPadSocial feeds it straight from its NSURLSession delegate
+//  so the raw body is not kept around either.
+//
+//  The parser understands the service's { "code": ..., "message": ... } envelope. The "message" value may be either a
+//  JSON array or a string holding a JSON array (the form the service uses today); in the latter case the string is
+//  unescaped on the fly.
+
+#import <Foundation/Foundation.h>
+
+@class Patch;
+
+typedef void(^PatchListStreamBatchHandler)(NSArray<Patch *> *patchesBatch);
+
+@interface PatchListStreamParser : NSObject
+
+- (PatchListStreamParser *)initWithBatchSize:(NSUInteger)batchSize batchHandler:(PatchListStreamBatchHandler)batchHandler;
+
+// Parses the next chunk of the response body. The batch handler is called synchronously on the calling thread each
+// time batchSize patches have been parsed.
+- (void)appendData:(NSData *)data;
+
+// Returns the patches parsed since the last full batch was handed out (possibly an empty array). Call once after the
+// last chunk has been appended.
+- (NSArray<Patch *> *)finish;
+
+// Value of the envelope's top-level "code" field or 0 if it has not been seen (yet).
+@property(nonatomic, readonly) NSInteger responseCode;
+
+// Total number of patches parsed so far.
+@property(nonatomic, readonly) NSUInteger patchCount;
+
+// Set if an element of the list could not be decoded into a patch. No further patches are handed out after that since
+// the list would silently be missing one.
+@property(nonatomic, readonly) NSError *error;
+
+@end
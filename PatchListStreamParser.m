@@ -0,0 +1,350 @@
+//
+//  PatchListStreamParser.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Parsing happens in three stacked stages, each driven one byte at a time:
+//      1 - The envelope scanner tracks nesting and strings of the outer JSON object, picks up the "code" value, and
+//          forwards the bytes of the "message" value.
+//      2 - If "message" is a string, its escape sequences are undone so the stage below sees the JSON it contains.
+//      3 - The list splitter walks the message's top-level array and cuts out each complete {...} element, which is
+//          decoded with NSJSONSerialization and turned into a Patch.
+//  The stages are plain C functions (rather than methods) because they run once per byte of the response.
+
+#import <Foundation/Foundation.h>
+
+#import "PatchListStreamParser.h"
+#import "Patch.h"
+#import "PatchIdentityMap.h"
+
+static const char *const ENVELOPE_MESSAGE_KEY = "message";
+static const char *const ENVELOPE_CODE_KEY = "code";
+
+typedef enum {
+    EnvelopeKeyOther,
+    EnvelopeKeyCode,
+    EnvelopeKeyMessage
+} EnvelopeKey;
+
+static void scanEnvelopeByte(PatchListStreamParser *parser, uint8_t c);
+
+@implementation PatchListStreamParser {
+    @private NSUInteger batchSize;
+    @private PatchListStreamBatchHandler batchHandler;
+    @private NSMutableArray *currentBatch;
+
+    // Stage 1 - envelope scanner
+    @private NSInteger envelopeDepth;
+    @private BOOL envelopeInString;
+    @private BOOL envelopeEscape;
+    @private BOOL envelopeExpectingKey;
+    @private BOOL envelopeCapturingKey;
+    @private BOOL envelopeValuePending;
+    @private EnvelopeKey envelopeCurrentKey;
+    @private NSMutableData *envelopeKeyBuffer;
+    @private BOOL messageIsString;
+    @private BOOL messageIsRaw;
+
+    // Stage 2 - string unescaper
+    @private BOOL unescapeEscape;
+    @private int unescapeHexRemaining;
+    @private uint32_t unescapeCodePoint;
+    @private uint32_t unescapeHighSurrogate;
+
+    // Stage 3 - list splitter
+    @private BOOL listStarted;
+    @private BOOL listDisabled;
+    @private NSInteger listDepth;
+    @private BOOL listInString;
+    @private BOOL listEscape;
+    @private NSMutableData *elementBuffer;
+}
+
+- (PatchListStreamParser *)initWithBatchSize:(NSUInteger)size batchHandler:(PatchListStreamBatchHandler)handler {
+    if (self = [super init]) {
+        batchSize = MAX(size, 1);
+        batchHandler = handler;
+        currentBatch = [[NSMutableArray alloc] initWithCapacity:batchSize];
+        envelopeKeyBuffer = [[NSMutableData alloc] init];
+        elementBuffer = [[NSMutableData alloc] init];
+    }
+    return self;
+}
+
+- (void)appendData:(NSData *)data {
+    [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop) {
+        const uint8_t *cursor = bytes;
+        for (NSUInteger i = 0; i < byteRange.length; i++) {
+            scanEnvelopeByte(self, cursor[i]);
+        }
+    }];
+}
+
+- (NSArray<Patch *> *)finish {
+    NSArray *remaining = currentBatch;
+    currentBatch = [[NSMutableArray alloc] initWithCapacity:batchSize];
+    return remaining;
+}
+
+#pragma mark - Stage 3 - List splitter
+
+static void emitElement(PatchListStreamParser *parser) {
+    NSError *error = nil;
+    id json = [NSJSONSerialization JSONObjectWithData:parser->elementBuffer options:0 error:&error];
+    [parser->elementBuffer setLength:0];
+
+    if (![json isKindOfClass:[NSDictionary class]]) {
+        NSLog(@"PatchListStreamParser - could not decode patch %lu of the list", (unsigned long)parser->_patchCount);
+        parser->_error = error ?: [NSError errorWithDomain:NSCocoaErrorDomain code:NSPropertyListReadCorruptError userInfo:nil];
+        parser->listDisabled = YES;
+        return;
+    }
+
+    [parser->currentBatch addObject:[[PatchIdentityMap sharedInstance] patchForDictionary:json]];
+    parser->_patchCount++;
+
+    if ([parser->currentBatch count] >= parser->batchSize) {
+        NSArray *batch = parser->currentBatch;
+        parser->currentBatch = [[NSMutableArray alloc] initWithCapacity:parser->batchSize];
+        parser->batchHandler(batch);
+    }
+}
+
+static void splitListByte(PatchListStreamParser *parser, uint8_t c) {
+    if (parser->listDisabled) {
+        return;
+    }
+
+    // The message must be an array; anything else (e.g. an error string) is ignored
+    if (!parser->listStarted) {
+        if (isspace(c)) {
+            return;
+        }
+        if (c == '[') {
+            parser->listStarted = YES;
+            parser->listDepth = 1;
+        } else {
+            parser->listDisabled = YES;
+        }
+        return;
+    }
+
+    if (parser->listDepth == 0) {
+        return;
+    }
+
+    if (parser->listDepth >= 2) {
+        [parser->elementBuffer appendBytes:&c length:1];
+    }
+
+    if (parser->listInString) {
+        if (parser->listEscape) {
+            parser->listEscape = NO;
+        } else if (c == '\\') {
+            parser->listEscape = YES;
+        } else if (c == '"') {
+            parser->listInString = NO;
+        }
+        return;
+    }
+
+    switch (c) {
+        case '"':
+            parser->listInString = YES;
+            break;
+        case '{':
+        case '[':
+            if (parser->listDepth == 1) {
+                [parser->elementBuffer setLength:0];
+                [parser->elementBuffer appendBytes:&c length:1];
+            }
+            parser->listDepth++;
+            break;
+        case '}':
+        case ']':
+            parser->listDepth--;
+            if (parser->listDepth == 1) {
+                emitElement(parser);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+#pragma mark - Stage 2 - String unescaper
+
+static void emitCodePoint(PatchListStreamParser *parser, uint32_t codePoint) {
+    // Surrogate pairs arrive as two \u escapes; hold on to the high half until the low half shows up
+    if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+        parser->unescapeHighSurrogate = codePoint;
+        return;
+    }
+
+    if (codePoint >= 0xDC00 && codePoint <= 0xDFFF && parser->unescapeHighSurrogate != 0) {
+        codePoint = 0x10000 + ((parser->unescapeHighSurrogate - 0xD800) << 10) + (codePoint - 0xDC00);
+    }
+    parser->unescapeHighSurrogate = 0;
+
+    if (codePoint < 0x80) {
+        splitListByte(parser, (uint8_t)codePoint);
+    } else if (codePoint < 0x800) {
+        splitListByte(parser, (uint8_t)(0xC0 | (codePoint >> 6)));
+        splitListByte(parser, (uint8_t)(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        splitListByte(parser, (uint8_t)(0xE0 | (codePoint >> 12)));
+        splitListByte(parser, (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F)));
+        splitListByte(parser, (uint8_t)(0x80 | (codePoint & 0x3F)));
+    } else {
+        splitListByte(parser, (uint8_t)(0xF0 | (codePoint >> 18)));
+        splitListByte(parser, (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F)));
+        splitListByte(parser, (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F)));
+        splitListByte(parser, (uint8_t)(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+static int hexValue(uint8_t c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+static void unescapeByte(PatchListStreamParser *parser, uint8_t c) {
+    if (parser->unescapeHexRemaining > 0) {
+        parser->unescapeCodePoint = (parser->unescapeCodePoint << 4) | hexValue(c);
+        if (--parser->unescapeHexRemaining == 0) {
+            emitCodePoint(parser, parser->unescapeCodePoint);
+        }
+        return;
+    }
+
+    if (parser->unescapeEscape) {
+        parser->unescapeEscape = NO;
+        switch (c) {
+            case 'n': splitListByte(parser, '\n'); break;
+            case 't': splitListByte(parser, '\t'); break;
+            case 'r': splitListByte(parser, '\r'); break;
+            case 'b': splitListByte(parser, '\b'); break;
+            case 'f': splitListByte(parser, '\f'); break;
+            case 'u':
+                parser->unescapeHexRemaining = 4;
+                parser->unescapeCodePoint = 0;
+                break;
+            default:
+                // \" \\ and \/ all unescape to the character itself
+                splitListByte(parser, c);
+                break;
+        }
+        return;
+    }
+
+    if (c == '\\') {
+        parser->unescapeEscape = YES;
+        return;
+    }
+
+    splitListByte(parser, c);
+}
+
+#pragma mark - Stage 1 - Envelope scanner
+
+static EnvelopeKey envelopeKeyForBuffer(NSData *keyBuffer) {
+    if ([keyBuffer length] == strlen(ENVELOPE_MESSAGE_KEY) && memcmp([keyBuffer bytes], ENVELOPE_MESSAGE_KEY, [keyBuffer length]) == 0) {
+        return EnvelopeKeyMessage;
+    }
+    if ([keyBuffer length] == strlen(ENVELOPE_CODE_KEY) && memcmp([keyBuffer bytes], ENVELOPE_CODE_KEY, [keyBuffer length]) == 0) {
+        return EnvelopeKeyCode;
+    }
+    return EnvelopeKeyOther;
+}
+
+static void captureCodeDigit(PatchListStreamParser *parser, uint8_t c) {
+    if (parser->envelopeDepth == 1 && parser->envelopeCurrentKey == EnvelopeKeyCode && c >= '0' && c <= '9') {
+        parser->_responseCode = parser->_responseCode * 10 + (c - '0');
+    }
+}
+
+static void scanEnvelopeByte(PatchListStreamParser *parser, uint8_t c) {
+    // A raw (non-string) message is passed straight through to the list splitter
+    if (parser->messageIsRaw) {
+        splitListByte(parser, c);
+    }
+
+    if (parser->envelopeInString) {
+        if (parser->envelopeEscape) {
+            parser->envelopeEscape = NO;
+        } else if (c == '\\') {
+            parser->envelopeEscape = YES;
+        } else if (c == '"') {
+            parser->envelopeInString = NO;
+            if (parser->envelopeCapturingKey) {
+                parser->envelopeCapturingKey = NO;
+                parser->envelopeCurrentKey = envelopeKeyForBuffer(parser->envelopeKeyBuffer);
+            }
+            parser->messageIsString = NO;
+            return;
+        }
+
+        if (parser->envelopeCapturingKey) {
+            [parser->envelopeKeyBuffer appendBytes:&c length:1];
+        } else if (parser->messageIsString) {
+            unescapeByte(parser, c);
+        } else {
+            captureCodeDigit(parser, c);
+        }
+        return;
+    }
+
+    switch (c) {
+        case '"':
+            parser->envelopeInString = YES;
+            if (parser->envelopeDepth == 1 && parser->envelopeExpectingKey) {
+                parser->envelopeExpectingKey = NO;
+                parser->envelopeCapturingKey = YES;
+                [parser->envelopeKeyBuffer setLength:0];
+            } else if (parser->envelopeDepth == 1 && parser->envelopeValuePending && parser->envelopeCurrentKey == EnvelopeKeyMessage) {
+                parser->messageIsString = YES;
+            }
+            parser->envelopeValuePending = NO;
+            break;
+        case '{':
+        case '[':
+            if (parser->envelopeDepth == 1 && parser->envelopeValuePending && parser->envelopeCurrentKey == EnvelopeKeyMessage) {
+                parser->messageIsRaw = YES;
+                splitListByte(parser, c);
+            }
+            parser->envelopeValuePending = NO;
+            parser->envelopeDepth++;
+            if (parser->envelopeDepth == 1) {
+                parser->envelopeExpectingKey = YES;
+            }
+            break;
+        case '}':
+        case ']':
+            parser->envelopeDepth--;
+            if (parser->envelopeDepth == 1) {
+                parser->messageIsRaw = NO;
+            }
+            break;
+        case ':':
+            if (parser->envelopeDepth == 1) {
+                parser->envelopeValuePending = YES;
+            }
+            break;
+        case ',':
+            if (parser->envelopeDepth == 1) {
+                parser->envelopeExpectingKey = YES;
+                parser->envelopeCurrentKey = EnvelopeKeyOther;
+            }
+            break;
+        default:
+            if (!isspace(c)) {
+                parser->envelopeValuePending = NO;
+                captureCodeDigit(parser, c);
+            }
+            break;
+    }
+}
+
+@end
@@ -10,24 +10,15 @@
 
 #import "PatchResource.h"
 #import "NSDate+Helper.h"
+#import "TimestampFormatter.h"
 
 @implementation PatchResource
 
-static NSDateFormatter *dateFormatter;
-
 - (PatchResource *)initWithDictionary:(NSDictionary *)dictionary {
-    // Initialize our static date formatter so we can convert Ruby DateTime objects to NSDate's properly
-    // http://stackoverflow.com/a/26803370/265791
-    // http://stackoverflow.com/a/9132422/265791
-    if (dateFormatter == nil) {
-        dateFormatter = [[NSDateFormatter alloc] init];
-        [dateFormatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
-    }
-    
     if (self = [super init]) {
         self.patchGUID = dictionary[@"guid"];
         self.version = [dictionary[@"version"] integerValue];
-        self.createdAt = [dateFormatter dateFromString:dictionary[@"created_at"]];
+        self.createdAt = [TimestampFormatter dateFromString:dictionary[@"created_at"]];
     }
 
     return self;
@@ -46,7 +37,7 @@ static NSDateFormatter *dateFormatter;
 - (NSDictionary *)asDictionary {
     return @{ @"guid" : self.patchGUID,
               @"version" : @(self.version),
-              @"created_at" : [dateFormatter stringFromDate:self.createdAt] };
+              @"created_at" : [TimestampFormatter stringFromDate:self.createdAt] };
 }
 
 - (NSString *)getTimeResourceWasCreatedWithPrefix:(BOOL)prefix {
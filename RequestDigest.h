@@ -0,0 +1,17 @@
+//
+//  RequestDigest.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  The digest the service checks on every signed request. Kept apart from ChuckPadSocial so it can be checked on its
+//  own against the string-building version it replaced (see Tests/RequestDigestCheck.m).
+
+#import <Foundation/Foundation.h>
+
+@interface RequestDigest : NSObject
+
+// Uppercase hex SHA-256 of every key followed by the description of its value, in case-insensitive key order. Values
+// are expected to be NSStrings and NSNumbers; anything else is hashed as its description.
++ (NSString *)digestForParameters:(NSDictionary *)parameters;
+
+@end
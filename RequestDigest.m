@@ -0,0 +1,79 @@
+//
+//  RequestDigest.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+
+#import "RequestDigest.h"
+
+#include <CommonCrypto/CommonDigest.h>
+
+static void updateDigestWithString(CC_SHA256_CTX *context, NSString *string) {
+    uint8_t buffer[256];
+    NSUInteger usedLength = 0;
+    NSRange remainingRange = NSMakeRange(0, [string length]);
+    while (remainingRange.length > 0) {
+        if (![string getBytes:buffer maxLength:sizeof(buffer) usedLength:&usedLength encoding:NSUTF8StringEncoding
+                      options:0 range:remainingRange remainingRange:&remainingRange]) {
+            break;
+        }
+        CC_SHA256_Update(context, buffer, (CC_LONG)usedLength);
+    }
+}
+
+// Values are hashed as their description (what %@ formatting produces). Integer NSNumbers, which is what we send, are
+// written out directly instead of going through an intermediate string.
+static void updateDigestWithValue(CC_SHA256_CTX *context, id value) {
+    if ([value isKindOfClass:[NSString class]]) {
+        updateDigestWithString(context, value);
+        return;
+    }
+    
+    if ([value isKindOfClass:[NSNumber class]]) {
+        char buffer[32];
+        int length = -1;
+        switch ([value objCType][0]) {
+            case 'c': case 's': case 'i': case 'l': case 'q':
+                length = snprintf(buffer, sizeof(buffer), "%lld", [value longLongValue]);
+                break;
+            case 'C': case 'S': case 'I': case 'L': case 'Q':
+                length = snprintf(buffer, sizeof(buffer), "%llu", [value unsignedLongLongValue]);
+                break;
+            default:
+                break;
+        }
+        if (length > 0) {
+            CC_SHA256_Update(context, buffer, (CC_LONG)length);
+            return;
+        }
+    }
+    
+    updateDigestWithString(context, [value description]);
+}
+
+@implementation RequestDigest
+
+// The UTF-8 bytes of each key and value are fed straight into the hash rather than building the whole string first.
++ (NSString *)digestForParameters:(NSDictionary *)parameters {
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+    
+    NSArray *sortedKeys = [[parameters allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)];
+    for (NSString *key in sortedKeys) {
+        updateDigestWithString(&context, key);
+        updateDigestWithValue(&context, parameters[key]);
+    }
+    
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_Final(digest, &context);
+    
+    static const char hexCharacters[] = "0123456789ABCDEF";
+    char hexDigest[CC_SHA256_DIGEST_LENGTH * 2];
+    for (NSInteger i = 0; i < CC_SHA256_DIGEST_LENGTH; ++i) {
+        hexDigest[i * 2] = hexCharacters[digest[i] >> 4];
+        hexDigest[i * 2 + 1] = hexCharacters[digest[i] & 0x0F];
+    }
+    return [[NSString alloc] initWithBytes:hexDigest length:sizeof(hexDigest) encoding:NSASCIIStringEncoding];
+}
+
+@end
@@ -0,0 +1,36 @@
+//
+//  Check.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Shared by the standalone checks in this folder. Each check is a single file with its own main that needs neither the
+//  service nor an Xcode project, and only builds when CHUCKPAD_SOCIAL_CHECKS is defined so adding the library folder
+//  to an app target is unaffected. The top of each file has the command line to build and run it from the repository
+//  root on a Mac.
+
+#import <Foundation/Foundation.h>
+
+static NSUInteger failureCount = 0;
+
+static inline void check(BOOL condition, NSString *description) {
+    if (!condition) {
+        failureCount++;
+    }
+    NSLog(@"%@ - %@", condition ? @"PASS" : @"FAIL", description);
+}
+
+// Average time in milliseconds of one run of block
+static inline double millisecondsPerRun(NSUInteger iterations, void (^block)(void)) {
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger i = 0; i < iterations; i++) {
+        @autoreleasepool {
+            block();
+        }
+    }
+    return (CFAbsoluteTimeGetCurrent() - start) * 1000 / iterations;
+}
+
+static inline int checkResult(void) {
+    NSLog(@"%lu check(s) failed", (unsigned long)failureCount);
+    return failureCount == 0 ? 0 : 1;
+}
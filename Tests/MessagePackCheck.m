@@ -0,0 +1,196 @@
+//
+//  MessagePackCheck.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Checks that MessagePackDecoder decodes what a small encoder below produces, every encoding the service may use, and
+//  rejects malformed documents. Also prints the size of a patch list as MessagePack and as JSON and how long each
+//  takes to decode. Build and run from the repository root:
+//
+//      clang -fobjc-arc -DCHUCKPAD_SOCIAL_CHECKS -framework Foundation -I. \
+//          Tests/MessagePackCheck.m MessagePackDecoder.m -o message-pack-check && ./message-pack-check
+
+#ifdef CHUCKPAD_SOCIAL_CHECKS
+
+#import <Foundation/Foundation.h>
+
+#import "Check.h"
+#import "MessagePackDecoder.h"
+
+static const NSUInteger PATCH_LIST_COUNT = 500;
+static const NSUInteger DECODE_ITERATIONS = 50;
+
+static void appendBigEndian(NSMutableData *data, uint64_t value, NSUInteger byteCount) {
+    for (NSInteger shift = (byteCount - 1) * 8; shift >= 0; shift -= 8) {
+        uint8_t byte = (value >> shift) & 0xff;
+        [data appendBytes:&byte length:1];
+    }
+}
+
+static void appendTypeAndLength(NSMutableData *data, uint8_t fixType, NSUInteger fixLimit, uint8_t type8, uint8_t type16,
+                                uint8_t type32, NSUInteger length) {
+    uint8_t type;
+    if (length < fixLimit) {
+        type = fixType | (uint8_t)length;
+        [data appendBytes:&type length:1];
+    } else if (type8 != 0 && length <= UINT8_MAX) {
+        [data appendBytes:&type8 length:1];
+        appendBigEndian(data, length, 1);
+    } else if (length <= UINT16_MAX) {
+        [data appendBytes:&type16 length:1];
+        appendBigEndian(data, length, 2);
+    } else {
+        [data appendBytes:&type32 length:1];
+        appendBigEndian(data, length, 4);
+    }
+}
+
+// Just enough of an encoder to produce the documents the service sends
+static void appendMessagePack(NSMutableData *data, id object) {
+    uint8_t type;
+    if (object == [NSNull null]) {
+        type = 0xc0;
+        [data appendBytes:&type length:1];
+    } else if ([object isKindOfClass:[NSNumber class]]) {
+        const char *objCType = [object objCType];
+        if (CFGetTypeID((__bridge CFTypeRef)object) == CFBooleanGetTypeID()) {
+            type = [object boolValue] ? 0xc3 : 0xc2;
+            [data appendBytes:&type length:1];
+        } else if (strcmp(objCType, @encode(double)) == 0 || strcmp(objCType, @encode(float)) == 0) {
+            double value = [object doubleValue];
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            type = 0xcb;
+            [data appendBytes:&type length:1];
+            appendBigEndian(data, bits, 8);
+        } else {
+            long long value = [object longLongValue];
+            if (value >= 0 && value < 128) {
+                type = (uint8_t)value;
+                [data appendBytes:&type length:1];
+            } else if (value < 0 && value >= -32) {
+                type = (uint8_t)(int8_t)value;
+                [data appendBytes:&type length:1];
+            } else {
+                type = value >= 0 ? 0xcf : 0xd3;
+                [data appendBytes:&type length:1];
+                appendBigEndian(data, (uint64_t)value, 8);
+            }
+        }
+    } else if ([object isKindOfClass:[NSString class]]) {
+        NSData *utf8 = [object dataUsingEncoding:NSUTF8StringEncoding];
+        appendTypeAndLength(data, 0xa0, 32, 0xd9, 0xda, 0xdb, [utf8 length]);
+        [data appendData:utf8];
+    } else if ([object isKindOfClass:[NSData class]]) {
+        appendTypeAndLength(data, 0, 0, 0xc4, 0xc5, 0xc6, [object length]);
+        [data appendData:object];
+    } else if ([object isKindOfClass:[NSArray class]]) {
+        appendTypeAndLength(data, 0x90, 16, 0, 0xdc, 0xdd, [object count]);
+        for (id element in object) {
+            appendMessagePack(data, element);
+        }
+    } else if ([object isKindOfClass:[NSDictionary class]]) {
+        appendTypeAndLength(data, 0x80, 16, 0, 0xde, 0xdf, [object count]);
+        for (id key in object) {
+            appendMessagePack(data, key);
+            appendMessagePack(data, object[key]);
+        }
+    }
+}
+
+static NSData *dataWithBytes(const uint8_t *bytes, NSUInteger length) {
+    return [NSData dataWithBytes:bytes length:length];
+}
+
+// Shaped like a getRecentPatches response
+static NSArray *patchList(NSUInteger count) {
+    NSMutableArray *patches = [[NSMutableArray alloc] initWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        [patches addObject:@{ @"guid" : [[NSUUID UUID] UUIDString],
+                              @"name" : [NSString stringWithFormat:@"Patch %lu", (unsigned long)i],
+                              @"description" : @"SinOsc s => dac; 440 => s.freq; 1::second => now; — ünïcödé",
+                              @"featured" : @(i % 7 == 0 ? YES : NO),
+                              @"documentation" : @NO,
+                              @"hidden" : @NO,
+                              @"latitude" : i % 3 == 0 ? [NSNull null] : @(37.4275 + i / 1000.0),
+                              @"longitude" : i % 3 == 0 ? [NSNull null] : @(-122.1697 - i / 1000.0),
+                              @"creator_id" : @(1000 + i),
+                              @"creator_username" : @"chuckpad-user",
+                              @"abuse_count" : @0,
+                              @"resource" : [NSString stringWithFormat:@"/patch/download/%lu", (unsigned long)i],
+                              @"created_at" : @"2016-06-17 12:34:56",
+                              @"updated_at" : @"2016-06-18 01:02:03",
+                              @"download_count" : @(i * 31),
+                              @"parent_guid" : [NSNull null],
+                              @"revision" : @(i % 5) }];
+    }
+    return patches;
+}
+
+static void checkMessagePack(void) {
+    NSArray *patches = patchList(PATCH_LIST_COUNT);
+    NSMutableData *messagePack = [[NSMutableData alloc] init];
+    appendMessagePack(messagePack, patches);
+    NSData *json = [NSJSONSerialization dataWithJSONObject:patches options:0 error:nil];
+
+    NSError *error = nil;
+    check([[MessagePackDecoder objectWithData:messagePack error:&error] isEqual:patches] && error == nil,
+          @"patch list round trips through MessagePack");
+
+    NSDictionary *edgeCases = @{ @"empty string" : @"",
+                                 @"long string" : [@"" stringByPaddingToLength:70000 withString:@"chuck " startingAtIndex:0],
+                                 @"negative fixint" : @(-5),
+                                 @"negative int64" : @(-5000000000LL),
+                                 @"large uint" : @(9000000000ULL),
+                                 @"double" : @(-0.125),
+                                 @"binary" : dataWithBytes((const uint8_t *)"\x00\x01\x02", 3),
+                                 @"empty array" : @[],
+                                 @"nested" : @{ @"a" : @[ @1, @[ @2, [NSNull null] ] ] } };
+    NSMutableData *edgeCaseData = [[NSMutableData alloc] init];
+    appendMessagePack(edgeCaseData, edgeCases);
+    check([[MessagePackDecoder objectWithData:edgeCaseData error:nil] isEqual:edgeCases], @"edge case values round trip");
+
+    // Encodings the encoder above never produces
+    const uint8_t float32[] = { 0xca, 0x3f, 0xc0, 0x00, 0x00 };
+    check([[MessagePackDecoder objectWithData:dataWithBytes(float32, sizeof(float32)) error:nil] isEqual:@1.5], @"float 32 decodes");
+    const uint8_t int8[] = { 0xd0, 0x80 };
+    check([[MessagePackDecoder objectWithData:dataWithBytes(int8, sizeof(int8)) error:nil] isEqual:@(-128)], @"int 8 decodes");
+    const uint8_t uint16[] = { 0xcd, 0x01, 0x00 };
+    check([[MessagePackDecoder objectWithData:dataWithBytes(uint16, sizeof(uint16)) error:nil] isEqual:@256], @"uint 16 decodes");
+    const uint8_t timestamp[] = { 0x91, 0xd6, 0xff, 0x57, 0x64, 0x2c, 0x00 };
+    check([[MessagePackDecoder objectWithData:dataWithBytes(timestamp, sizeof(timestamp)) error:nil] isEqual:@[ [NSNull null] ]],
+          @"extension types decode to NSNull");
+
+    // Malformed documents
+    error = nil;
+    NSData *truncated = [messagePack subdataWithRange:NSMakeRange(0, [messagePack length] - 1)];
+    check([MessagePackDecoder objectWithData:truncated error:&error] == nil && error != nil, @"truncated document is rejected");
+    NSMutableData *trailing = [messagePack mutableCopy];
+    [trailing appendBytes:"\xc0" length:1];
+    check([MessagePackDecoder objectWithData:trailing error:nil] == nil, @"trailing bytes are rejected");
+    const uint8_t neverUsed[] = { 0xc1 };
+    check([MessagePackDecoder objectWithData:dataWithBytes(neverUsed, sizeof(neverUsed)) error:nil] == nil, @"0xc1 is rejected");
+    const uint8_t hugeArray[] = { 0xdd, 0xff, 0xff, 0xff, 0xff };
+    check([MessagePackDecoder objectWithData:dataWithBytes(hugeArray, sizeof(hugeArray)) error:nil] == nil,
+          @"array longer than the document is rejected");
+
+    double messagePackTime = millisecondsPerRun(DECODE_ITERATIONS, ^{
+        [MessagePackDecoder objectWithData:messagePack error:nil];
+    });
+    double jsonTime = millisecondsPerRun(DECODE_ITERATIONS, ^{
+        [NSJSONSerialization JSONObjectWithData:json options:0 error:nil];
+    });
+
+    NSLog(@"%lu patches - MessagePack %lu bytes, %.2f ms to decode; JSON %lu bytes, %.2f ms to decode",
+          (unsigned long)PATCH_LIST_COUNT, (unsigned long)[messagePack length], messagePackTime,
+          (unsigned long)[json length], jsonTime);
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        checkMessagePack();
+    }
+    return checkResult();
+}
+
+#endif
@@ -0,0 +1,162 @@
+//
+//  PatchCacheCheck.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Hammers PatchCache's memory tier and its expiry and validator bookkeeping from many threads at once, then checks
+//  that every key still reads back what was last stored under it and that the hit and miss counters account for every
+//  lookup. Also checks that the byte limit evicts. Build and run from the repository root:
+//
+//      clang -fobjc-arc -DCHUCKPAD_SOCIAL_CHECKS -framework Foundation -I. -INSDate+Helper \
+//          Tests/PatchCacheCheck.m PatchCache.m PatchDiskCache.m PatchContentHashes.m Patch.m LiveSession.m \
+//          TimestampFormatter.m NSDate+Helper/NSDate+Helper.m -o patch-cache-check && ./patch-cache-check
+
+#ifdef CHUCKPAD_SOCIAL_CHECKS
+
+#import <Foundation/Foundation.h>
+
+#import "Check.h"
+#import "PatchCache.h"
+
+static const NSUInteger STRESS_THREAD_COUNT = 16;
+static const NSUInteger STRESS_OPERATIONS_PER_THREAD = 50000;
+static const NSUInteger STRESS_KEY_COUNT = 64;
+
+static _Atomic(NSUInteger) mismatchCount = 0;
+static _Atomic(NSUInteger) lookupCount = 0;
+
+static NSString *keyForIndex(NSUInteger index) {
+    return [NSString stringWithFormat:@"stress-%lu", (unsigned long)(index % STRESS_KEY_COUNT)];
+}
+
+// Every thread mixes reads and writes on a small set of shared keys so the same entries are contended constantly.
+// Some writes store objects that are already expired so lookups also take the remove-if-expired path.
+static void stress(PatchCache *cache) {
+    dispatch_group_t group = dispatch_group_create();
+    dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+
+    [cache resetStatistics];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger thread = 0; thread < STRESS_THREAD_COUNT; thread++) {
+        dispatch_group_async(group, queue, ^{
+            unsigned int seed = (unsigned int)thread + 1;
+            for (NSUInteger i = 0; i < STRESS_OPERATIONS_PER_THREAD; i++) {
+                @autoreleasepool {
+                    NSString *key = keyForIndex(rand_r(&seed));
+                    switch (rand_r(&seed) % 8) {
+                        case 0:
+                            [cache setObject:key forKey:key expire:60];
+                            break;
+                        case 1:
+                            [cache setObject:key forKey:key expire:-1];
+                            break;
+                        case 2:
+                            [cache setValidators:@{ @"ETag" : key } forKey:key];
+                            break;
+                        case 3: {
+                            NSDictionary *validators = [cache validatorsForKey:key];
+                            if (validators != nil && ![validators[@"ETag"] isEqual:key]) {
+                                mismatchCount++;
+                            }
+                            break;
+                        }
+                        case 4:
+                            [cache removeObjectForKey:key];
+                            break;
+                        default: {
+                            lookupCount++;
+                            id object = [cache objectForKey:key];
+                            if (object != nil && ![object isEqual:key]) {
+                                mismatchCount++;
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+        });
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+
+    check(mismatchCount == 0, @"concurrent lookups only ever return what was stored under their key");
+    check([cache hitCount] + [cache missCount] == lookupCount,
+          [NSString stringWithFormat:@"hits and misses add up to the %lu lookups made", (unsigned long)lookupCount]);
+    NSLog(@"%lu threads x %lu operations on %lu keys - %.0f ms, %.0f operations per second",
+          (unsigned long)STRESS_THREAD_COUNT, (unsigned long)STRESS_OPERATIONS_PER_THREAD, (unsigned long)STRESS_KEY_COUNT,
+          elapsed * 1000, STRESS_THREAD_COUNT * STRESS_OPERATIONS_PER_THREAD / elapsed);
+
+    // Once the threads are done the cache has to be in a consistent state again
+    BOOL consistent = YES;
+    for (NSUInteger i = 0; i < STRESS_KEY_COUNT; i++) {
+        NSString *key = keyForIndex(i);
+        [cache setObject:key forKey:key expire:60];
+        [cache setValidators:@{ @"ETag" : key } forKey:key];
+        consistent = consistent && [[cache objectForKey:key] isEqual:key] && [[cache validatorsForKey:key][@"ETag"] isEqual:key];
+    }
+    check(consistent, @"every key reads back what was last stored under it after the stress run");
+
+    [cache removeObjectsForKeyPrefix:@"stress-"];
+    BOOL removed = YES;
+    for (NSUInteger i = 0; i < STRESS_KEY_COUNT; i++) {
+        removed = removed && [cache objectForKey:keyForIndex(i)] == nil;
+    }
+    check(removed, @"removeObjectsForKeyPrefix removes every stressed key");
+}
+
+static void checkExpiry(PatchCache *cache) {
+    [cache setObject:@"fresh" forKey:@"fresh" expire:60];
+    check([[cache objectForKey:@"fresh"] isEqual:@"fresh"], @"unexpired object is returned");
+
+    [cache setObject:@"expired" forKey:@"expired" expire:-1];
+    check([cache objectForKey:@"expired"] == nil, @"expired object is not returned");
+    check([cache staleObjectForKey:@"expired"] == nil, @"expired object without validators is dropped");
+
+    [cache setObject:@"revalidate" forKey:@"revalidate" expire:-1];
+    [cache setValidators:@{ @"ETag" : @"\"abc\"" } forKey:@"revalidate"];
+    check([cache objectForKey:@"revalidate"] == nil, @"expired object with validators is not returned");
+    check([[cache staleObjectForKey:@"revalidate"] isEqual:@"revalidate"], @"expired object with validators is kept");
+
+    [cache removeAllObjects];
+    check([cache staleObjectForKey:@"revalidate"] == nil && [cache validatorsForKey:@"revalidate"] == nil,
+          @"removeAllObjects drops objects and validators");
+}
+
+static void checkByteLimit(PatchCache *cache) {
+    NSUInteger blobLength = 64 * 1024;
+    cache.byteLimit = 16 * blobLength;
+    [cache resetStatistics];
+
+    NSMutableData *blob = [NSMutableData dataWithLength:blobLength];
+    for (NSUInteger i = 0; i < 64; i++) {
+        [cache setObject:[blob copy] forKey:[NSString stringWithFormat:@"blob-%lu", (unsigned long)i] expire:60];
+    }
+
+    NSUInteger cachedCount = 0;
+    for (NSUInteger i = 0; i < 64; i++) {
+        if ([cache objectForKey:[NSString stringWithFormat:@"blob-%lu", (unsigned long)i]] != nil) {
+            cachedCount++;
+        }
+    }
+    check(cachedCount <= 16, [NSString stringWithFormat:@"%lu of 64 blobs kept under a 16 blob byte limit", (unsigned long)cachedCount]);
+    check([cache evictionCount] >= 64 - 16, [NSString stringWithFormat:@"%lu evictions counted", (unsigned long)[cache evictionCount]]);
+    check([cache hitCount] == cachedCount && [cache missCount] == 64 - cachedCount, @"hits and misses counted per lookup");
+
+    NSUInteger evictionCount = [cache evictionCount];
+    [cache removeAllObjects];
+    check([cache evictionCount] == evictionCount, @"removeAllObjects is not counted as evictions");
+
+    cache.byteLimit = PATCH_CACHE_BYTE_LIMIT;
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        PatchCache *cache = [[PatchCache alloc] init];
+        checkExpiry(cache);
+        stress(cache);
+        checkByteLimit(cache);
+    }
+    return checkResult();
+}
+
+#endif
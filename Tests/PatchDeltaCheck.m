@@ -0,0 +1,127 @@
+//
+//  PatchDeltaCheck.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Checks that deltas built by PatchDelta rebuild their target for typical edits and edge cases, stay small for small
+//  edits, and that damaged deltas or a wrong base are rejected. Also applies a delta whose target is many times larger
+//  than its inputs. Build and run from the repository root:
+//
+//      clang -fobjc-arc -DCHUCKPAD_SOCIAL_CHECKS -framework Foundation -I. \
+//          Tests/PatchDeltaCheck.m PatchDelta.m -o patch-delta-check && ./patch-delta-check
+
+#ifdef CHUCKPAD_SOCIAL_CHECKS
+
+#import <Foundation/Foundation.h>
+
+#import "Check.h"
+#import "PatchDelta.h"
+
+// Lines of a made-up ChucK script, different for every seed
+static NSData *script(NSUInteger lineCount, unsigned int seed) {
+    srandom(seed);
+    NSMutableString *script = [[NSMutableString alloc] init];
+    for (NSUInteger i = 0; i < lineCount; i++) {
+        [script appendFormat:@"SinOsc s%lu => Gain g%ld => dac; %ld => s%lu.freq; %ld::ms => now;\n",
+         (unsigned long)i, random() % 100, random() % 2000, (unsigned long)i, random() % 1000];
+    }
+    return [script dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+static NSData *splice(NSData *data, NSRange range, NSData *replacement) {
+    NSMutableData *result = [data mutableCopy];
+    [result replaceBytesInRange:range withBytes:[replacement bytes] length:[replacement length]];
+    return result;
+}
+
+static void appendVarint(NSMutableData *data, uint64_t value) {
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if (value != 0) {
+            byte |= 0x80;
+        }
+        [data appendBytes:&byte length:1];
+    } while (value != 0);
+}
+
+// A delta whose target is base repeated copyCount times, one copy op each, as a service may send for a version that
+// repeats its base
+static NSData *repeatingDelta(NSUInteger baseLength, NSUInteger copyCount) {
+    NSMutableData *delta = [[@"CPD1" dataUsingEncoding:NSASCIIStringEncoding] mutableCopy];
+    appendVarint(delta, baseLength);
+    appendVarint(delta, (uint64_t)baseLength * copyCount);
+    for (NSUInteger i = 0; i < copyCount; i++) {
+        uint8_t op = 0x02;
+        [delta appendBytes:&op length:1];
+        appendVarint(delta, 0);
+        appendVarint(delta, baseLength);
+    }
+    return delta;
+}
+
+static void checkDelta(NSString *description, NSData *base, NSData *target, BOOL expectSmall) {
+    NSData *delta = [PatchDelta deltaFromData:base toData:target];
+    NSData *rebuilt = [PatchDelta dataByApplyingDelta:delta toData:base];
+    check([rebuilt isEqualToData:target], [NSString stringWithFormat:@"%@ round trips (%lu byte delta for %lu bytes)",
+                                           description, (unsigned long)[delta length], (unsigned long)[target length]]);
+    if (expectSmall) {
+        check([delta length] < [target length] / 10, [NSString stringWithFormat:@"%@ delta is under a tenth of the data", description]);
+    }
+}
+
+static void checkPatchDelta(void) {
+    NSData *base = script(2000, 1);
+    NSUInteger middle = [base length] / 2;
+    NSData *line = [@"// a new comment\n" dataUsingEncoding:NSUTF8StringEncoding];
+
+    checkDelta(@"identical data", base, base, YES);
+    checkDelta(@"one line inserted", base, splice(base, NSMakeRange(middle, 0), line), YES);
+    checkDelta(@"block deleted", base, splice(base, NSMakeRange(middle, 500), [NSData data]), YES);
+    checkDelta(@"one byte changed", base, splice(base, NSMakeRange(middle, 1), [@"#" dataUsingEncoding:NSUTF8StringEncoding]), YES);
+    checkDelta(@"prepended and appended", base, splice(splice(base, NSMakeRange(0, 0), line), NSMakeRange([base length] + [line length], 0), line), YES);
+
+    NSData *firstHalf = [base subdataWithRange:NSMakeRange(0, middle)];
+    NSData *secondHalf = [base subdataWithRange:NSMakeRange(middle, [base length] - middle)];
+    NSMutableData *swapped = [secondHalf mutableCopy];
+    [swapped appendData:firstHalf];
+    checkDelta(@"halves swapped", base, swapped, YES);
+
+    checkDelta(@"unrelated data", base, script(2000, 2), NO);
+    checkDelta(@"empty base", [NSData data], base, NO);
+    checkDelta(@"empty target", base, [NSData data], NO);
+    checkDelta(@"shorter than a block", line, [@"x" dataUsingEncoding:NSUTF8StringEncoding], NO);
+
+    NSMutableData *repeated = [[NSMutableData alloc] init];
+    for (NSUInteger i = 0; i < 200; i++) {
+        [repeated appendData:base];
+    }
+    checkDelta(@"base repeated 200 times", base, repeated, YES);
+
+    NSData *shortBase = [base subdataWithRange:NSMakeRange(0, 4096)];
+    NSData *repeatingDeltaData = repeatingDelta([shortBase length], 5000);
+    NSData *rebuilt = [PatchDelta dataByApplyingDelta:repeatingDeltaData toData:shortBase];
+    BOOL repeatsBase = [rebuilt length] == [shortBase length] * 5000;
+    for (NSUInteger offset = 0; repeatsBase && offset < [rebuilt length]; offset += [shortBase length]) {
+        repeatsBase = [[rebuilt subdataWithRange:NSMakeRange(offset, [shortBase length])] isEqualToData:shortBase];
+    }
+    check(repeatsBase, [NSString stringWithFormat:@"%lu byte target from a %lu byte delta and %lu byte base is applied",
+                        (unsigned long)[shortBase length] * 5000, (unsigned long)[repeatingDeltaData length],
+                        (unsigned long)[shortBase length]]);
+
+    NSData *delta = [PatchDelta deltaFromData:base toData:swapped];
+    check([PatchDelta dataByApplyingDelta:delta toData:firstHalf] == nil, @"delta against a different base is rejected");
+    check([PatchDelta dataByApplyingDelta:[delta subdataWithRange:NSMakeRange(0, [delta length] - 1)] toData:base] == nil,
+          @"truncated delta is rejected");
+    check([PatchDelta dataByApplyingDelta:[@"not a delta" dataUsingEncoding:NSUTF8StringEncoding] toData:base] == nil,
+          @"data without the magic is rejected");
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        checkPatchDelta();
+    }
+    return checkResult();
+}
+
+#endif
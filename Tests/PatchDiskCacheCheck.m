@@ -0,0 +1,150 @@
+//
+//  PatchDiskCacheCheck.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Checks that PatchDiskCache shares blobs between keys, evicts the least recently used entries, and serves a second
+//  launch from disk, and prints how many bytes a launch has to fetch with an empty and with a warm disk tier. It uses
+//  the real chuckpad-social-cache folder in the caches directory and empties it. Build and run from the repository root:
+//
+//      clang -fobjc-arc -DCHUCKPAD_SOCIAL_CHECKS -framework Foundation -I. \
+//          Tests/PatchDiskCacheCheck.m PatchDiskCache.m PatchContentHashes.m -o patch-disk-cache-check && ./patch-disk-cache-check
+
+#ifdef CHUCKPAD_SOCIAL_CHECKS
+
+#import <Foundation/Foundation.h>
+
+#import "Check.h"
+#import "PatchDiskCache.h"
+
+static const NSUInteger RESOURCE_COUNT = 50;
+static const NSUInteger RESOURCE_LENGTH = 20 * 1024;
+
+// Longer than the delay PatchDiskCache waits before writing its index
+static const NSTimeInterval INDEX_WRITE_WAIT_SECONDS = 3;
+
+static NSData *resourceData(NSUInteger index, NSUInteger length) {
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    uint8_t *bytes = [data mutableBytes];
+    for (NSUInteger i = 0; i < length; i++) {
+        bytes[i] = (uint8_t)(i * 31 + index);
+    }
+    return data;
+}
+
+static NSString *resourceKey(NSUInteger index) {
+    return [NSString stringWithFormat:@"https://chuckpad-social.example.com/patch/download/%lu?revision=1", (unsigned long)index];
+}
+
+// What a launch that needs every resource would download: anything the disk tier does not have yet. Downloaded
+// resources are stored like ChuckPadSocial does.
+static NSUInteger bytesFetchedForLaunch(PatchDiskCache *diskCache) {
+    NSUInteger fetchedBytes = 0;
+    for (NSUInteger i = 0; i < RESOURCE_COUNT; i++) {
+        if ([diskCache dataForKey:resourceKey(i)] == nil) {
+            NSData *data = resourceData(i, RESOURCE_LENGTH);
+            fetchedBytes += [data length];
+            [diskCache setData:data forKey:resourceKey(i)];
+        }
+    }
+    return fetchedBytes;
+}
+
+static void checkColdStart(void) {
+    [[PatchDiskCache sharedInstance] removeAllData];
+
+    NSUInteger firstLaunchBytes = bytesFetchedForLaunch([PatchDiskCache sharedInstance]);
+    [NSThread sleepForTimeInterval:INDEX_WRITE_WAIT_SECONDS];
+
+    // A second instance reads the index from disk like the next launch of the app would
+    PatchDiskCache *relaunchedDiskCache = [[PatchDiskCache alloc] init];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    NSUInteger secondLaunchBytes = bytesFetchedForLaunch(relaunchedDiskCache);
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+
+    check(firstLaunchBytes == RESOURCE_COUNT * RESOURCE_LENGTH, @"a launch with an empty disk tier fetches everything");
+    check(secondLaunchBytes == 0, @"the next launch fetches nothing");
+    BOOL intact = YES;
+    for (NSUInteger i = 0; i < RESOURCE_COUNT; i++) {
+        intact = intact && [[relaunchedDiskCache dataForKey:resourceKey(i)] isEqualToData:resourceData(i, RESOURCE_LENGTH)];
+    }
+    check(intact, @"the next launch reads back the bytes that were stored");
+    NSLog(@"%lu resources - cold start fetched %lu bytes, warm start fetched %lu bytes and read the rest from disk in %.1f ms",
+          (unsigned long)RESOURCE_COUNT, (unsigned long)firstLaunchBytes, (unsigned long)secondLaunchBytes, elapsed * 1000);
+}
+
+static void checkOrphanedBlobs(void) {
+    PatchDiskCache *diskCache = [PatchDiskCache sharedInstance];
+    [diskCache removeAllData];
+
+    // Stands in for a blob written just before the app was killed, before the index that refers to it was written
+    NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+    NSString *blobsPath = [[cachesPath stringByAppendingPathComponent:@"chuckpad-social-cache"] stringByAppendingPathComponent:@"blobs"];
+    NSString *orphanPath = [blobsPath stringByAppendingPathComponent:[@"" stringByPaddingToLength:64 withString:@"0" startingAtIndex:0]];
+    [resourceData(0, RESOURCE_LENGTH) writeToFile:orphanPath atomically:YES];
+
+    PatchDiskCache *relaunchedDiskCache = [[PatchDiskCache alloc] init];
+    check(![[NSFileManager defaultManager] fileExistsAtPath:orphanPath], @"a blob no index entry refers to is deleted on launch");
+    check([relaunchedDiskCache totalBytes] == 0, @"a deleted orphan is not counted");
+}
+
+static void checkSharedBlobs(void) {
+    PatchDiskCache *diskCache = [PatchDiskCache sharedInstance];
+    [diskCache removeAllData];
+
+    NSData *data = resourceData(1, RESOURCE_LENGTH);
+    [diskCache setData:data forKey:@"first"];
+    [diskCache setData:data forKey:@"second"];
+    check([diskCache totalBytes] == RESOURCE_LENGTH, @"identical bytes under two keys are stored once");
+
+    [diskCache removeDataForKey:@"first"];
+    check([[diskCache dataForKey:@"second"] isEqualToData:data], @"removing one key keeps the blob the other key shares");
+    check([diskCache totalBytes] == RESOURCE_LENGTH, @"a shared blob is counted until its last key is removed");
+
+    [diskCache removeDataForKey:@"second"];
+    check([diskCache totalBytes] == 0 && [diskCache dataForKey:@"second"] == nil, @"removing the last key deletes the blob");
+
+    [diskCache setData:data forKey:@"replaced"];
+    [diskCache setData:resourceData(2, RESOURCE_LENGTH / 2) forKey:@"replaced"];
+    check([diskCache totalBytes] == RESOURCE_LENGTH / 2, @"storing new bytes under a key releases the old blob");
+}
+
+static void checkEviction(void) {
+    PatchDiskCache *diskCache = [PatchDiskCache sharedInstance];
+    [diskCache removeAllData];
+    NSUInteger byteLimit = [diskCache byteLimit];
+
+    for (NSUInteger i = 0; i < 4; i++) {
+        [diskCache setData:resourceData(i, RESOURCE_LENGTH) forKey:resourceKey(i)];
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    // Touch the oldest entry so the second one becomes the least recently used
+    [diskCache dataForKey:resourceKey(0)];
+    [NSThread sleepForTimeInterval:0.01];
+
+    diskCache.byteLimit = 3 * RESOURCE_LENGTH;
+    check([diskCache totalBytes] <= 3 * RESOURCE_LENGTH, @"lowering the byte limit evicts right away");
+    check([diskCache dataForKey:resourceKey(1)] == nil, @"the least recently used entry is evicted");
+    check([diskCache dataForKey:resourceKey(0)] != nil, @"a recently read entry is kept");
+
+    [diskCache setData:resourceData(4, RESOURCE_LENGTH) forKey:resourceKey(4)];
+    check([diskCache totalBytes] <= 3 * RESOURCE_LENGTH, @"storing past the byte limit evicts");
+    check([diskCache dataForKey:resourceKey(4)] != nil, @"the entry just stored is kept");
+
+    diskCache.byteLimit = byteLimit;
+    [diskCache removeAllData];
+    check([diskCache totalBytes] == 0, @"removeAllData empties the disk tier");
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        checkSharedBlobs();
+        checkEviction();
+        checkOrphanedBlobs();
+        checkColdStart();
+        [[PatchDiskCache sharedInstance] removeAllData];
+    }
+    return checkResult();
+}
+
+#endif
@@ -0,0 +1,103 @@
+//
+//  RequestDigestCheck.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Checks that RequestDigest produces exactly the digest signedParameters used to build by appending every key and
+//  %@-formatted value to a string and hashing its UTF-8 bytes, and times the two. Build and run from the repository
+//  root:
+//
+//      clang -fobjc-arc -DCHUCKPAD_SOCIAL_CHECKS -framework Foundation -I. \
+//          Tests/RequestDigestCheck.m RequestDigest.m -o request-digest-check && ./request-digest-check
+
+#ifdef CHUCKPAD_SOCIAL_CHECKS
+
+#import <Foundation/Foundation.h>
+
+#import "Check.h"
+#import "RequestDigest.h"
+
+#include <CommonCrypto/CommonDigest.h>
+
+static const NSUInteger DIGEST_ITERATIONS = 20000;
+
+// The digest as signedParameters computed it before RequestDigest
+static NSString *stringDigestForParameters(NSDictionary *parameters) {
+    NSArray *sortedKeys = [[parameters allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)];
+
+    NSMutableString *digest = [[NSMutableString alloc] init];
+    for (NSString *key in sortedKeys) {
+        [digest appendString:key];
+        [digest appendFormat:@"%@", parameters[key]];
+    }
+
+    NSData *data = [digest dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableData *sha256Out = [NSMutableData dataWithLength:CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256(data.bytes, (CC_LONG)data.length, sha256Out.mutableBytes);
+    NSMutableString *hexDigestString = [NSMutableString stringWithCapacity:sha256Out.length * 2];
+    const unsigned char *buf = sha256Out.bytes;
+    for (NSInteger i = 0; i < sha256Out.length; ++i) {
+        [hexDigestString appendFormat:@"%02X", buf[i]];
+    }
+    return hexDigestString;
+}
+
+static void checkDigest(NSString *description, NSDictionary *parameters) {
+    NSString *expected = stringDigestForParameters(parameters);
+    NSString *actual = [RequestDigest digestForParameters:parameters];
+    check([actual isEqualToString:expected], [NSString stringWithFormat:@"%@ (%@)", description, actual]);
+}
+
+// Shaped like the parameters of an uploadPatch call
+static NSDictionary *uploadParameters(NSUInteger descriptionLength) {
+    return @{ @"username" : @"chuckpad-user",
+              @"email" : @"user@example.com",
+              @"auth_token" : @"4c1c1a5e1b8b4f0c9b0e2b7d4f5a6c7d",
+              @"patch_name" : @"Sine Sweep",
+              @"patch_description" : [@"" stringByPaddingToLength:descriptionLength withString:@"SinOsc s => dac; "
+                                                  startingAtIndex:0],
+              @"patch_hidden" : @"0",
+              @"patch_type" : @"1",
+              @"random" : @"9F1C0B7E2D3A4C5B8E6F7A1B2C3D4E5F",
+              @"version" : @(1) };
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        checkDigest(@"no parameters", @{});
+        checkDigest(@"upload parameters", uploadParameters(200));
+        checkDigest(@"long description", uploadParameters(100000));
+        checkDigest(@"keys differing only in case", @{ @"Name" : @"a", @"name" : @"b", @"NAME" : @"c", @"b" : @"d" });
+
+        // Multibyte characters that straddle the 256-byte buffer RequestDigest reads strings through
+        NSString *multibyte = [@"" stringByPaddingToLength:1000 withString:@"é音🎹" startingAtIndex:0];
+        checkDigest(@"multibyte values", @{ @"patch_description" : multibyte, @"ü" : @"ß" });
+        for (NSUInteger offset = 250; offset < 260; offset++) {
+            NSString *value = [[@"" stringByPaddingToLength:offset withString:@"x" startingAtIndex:0] stringByAppendingString:@"🎹🎹🎹"];
+            checkDigest([NSString stringWithFormat:@"emoji after %lu ASCII characters", (unsigned long)offset], @{ @"k" : value });
+        }
+
+        checkDigest(@"NSNumber kinds", @{ @"int" : @(-42),
+                                          @"long long" : @(LLONG_MIN),
+                                          @"unsigned long long" : @(ULLONG_MAX),
+                                          @"bool" : @YES,
+                                          @"char" : [NSNumber numberWithChar:'A'],
+                                          @"unsigned short" : [NSNumber numberWithUnsignedShort:65535],
+                                          @"double" : @(0.1),
+                                          @"whole double" : @(3.0),
+                                          @"float" : @(1.5f) });
+        checkDigest(@"other values", @{ @"null" : [NSNull null], @"array" : @[ @1, @"two" ], @"empty" : @"" });
+
+        NSDictionary *parameters = uploadParameters(200);
+        double stringTime = millisecondsPerRun(DIGEST_ITERATIONS, ^{
+            stringDigestForParameters(parameters);
+        });
+        double streamedTime = millisecondsPerRun(DIGEST_ITERATIONS, ^{
+            [RequestDigest digestForParameters:parameters];
+        });
+        NSLog(@"upload parameters - string digest %.4f ms, RequestDigest %.4f ms", stringTime, streamedTime);
+    }
+    return checkResult();
+}
+
+#endif
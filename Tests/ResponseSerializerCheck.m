@@ -0,0 +1,108 @@
+//
+//  ResponseSerializerCheck.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Checks that ChuckPadResponseSerializer decodes the { "code": ..., "message": ... } envelope to the same objects as
+//  the AFJSONResponseSerializer plus second NSJSONSerialization pass the mappers used before, and times both on a
+//  10k-patch list. Build and run from the repository root:
+//
+//      clang -fobjc-arc -DCHUCKPAD_SOCIAL_CHECKS -framework Cocoa -I. -IAFNetworking \
+//          Tests/ResponseSerializerCheck.m ChuckPadResponseSerializer.m MessagePackDecoder.m \
+//          AFNetworking/AFURLResponseSerialization.m -o response-serializer-check && ./response-serializer-check
+
+#ifdef CHUCKPAD_SOCIAL_CHECKS
+
+#import <Foundation/Foundation.h>
+
+#import "Check.h"
+#import "ChuckPadResponseSerializer.h"
+
+static const NSUInteger PATCH_LIST_COUNT = 10000;
+static const NSUInteger DECODE_ITERATIONS = 10;
+
+// Shaped like a getRecentPatches response
+static NSArray *patchList(NSUInteger count) {
+    NSMutableArray *patches = [[NSMutableArray alloc] initWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        [patches addObject:@{ @"guid" : [[NSUUID UUID] UUIDString],
+                              @"name" : [NSString stringWithFormat:@"Patch %lu", (unsigned long)i],
+                              @"description" : i % 10 == 0 ? @"SinOsc s => dac; — ünïcödé 🎹" : @"SinOsc s => dac; 440 => s.freq;",
+                              @"featured" : @(i % 7 == 0),
+                              @"documentation" : @NO,
+                              @"hidden" : @NO,
+                              @"latitude" : @(37.4275),
+                              @"longitude" : @(-122.1697),
+                              @"creator_id" : @(1000 + i),
+                              @"creator_username" : @"chuckpad-user",
+                              @"abuse_count" : @0,
+                              @"resource" : [NSString stringWithFormat:@"/patch/download/%lu", (unsigned long)i],
+                              @"created_at" : @"2016-06-17 12:34:56",
+                              @"updated_at" : @"2016-06-18 01:02:03",
+                              @"download_count" : @(i * 31),
+                              @"revision" : @(i % 5) }];
+    }
+    return patches;
+}
+
+static NSData *envelope(id message) {
+    return [NSJSONSerialization dataWithJSONObject:@{ @"code" : @200, @"message" : message } options:0 error:nil];
+}
+
+static NSHTTPURLResponse *response(void) {
+    return [[NSHTTPURLResponse alloc] initWithURL:[NSURL URLWithString:@"https://chuckpad-social.example.com/patch/new"]
+                                       statusCode:200
+                                      HTTPVersion:@"HTTP/1.1"
+                                     headerFields:@{ @"Content-Type" : @"application/json; charset=utf-8" }];
+}
+
+// How the message was decoded before ChuckPadResponseSerializer: the envelope by AFJSONResponseSerializer, then the
+// message string converted to UTF-8 data and decoded again in the mapper
+static id mapperDecodedMessage(AFJSONResponseSerializer *serializer, NSData *data) {
+    NSDictionary *responseObject = [serializer responseObjectForResponse:response() data:data error:nil];
+    NSData *messageData = [responseObject[@"message"] dataUsingEncoding:NSUTF8StringEncoding];
+    return [NSJSONSerialization JSONObjectWithData:messageData options:0 error:nil];
+}
+
+static id serializerDecodedMessage(ChuckPadResponseSerializer *serializer, NSData *data) {
+    return [serializer responseObjectForResponse:response() data:data error:nil][@"message"];
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        AFJSONResponseSerializer *jsonSerializer = [AFJSONResponseSerializer serializer];
+        ChuckPadResponseSerializer *serializer = [[ChuckPadResponseSerializer alloc] init];
+
+        NSArray *patches = patchList(PATCH_LIST_COUNT);
+        NSString *message = [[NSString alloc] initWithData:[NSJSONSerialization dataWithJSONObject:patches options:0 error:nil]
+                                                  encoding:NSUTF8StringEncoding];
+        NSData *listData = envelope(message);
+
+        id expected = mapperDecodedMessage(jsonSerializer, listData);
+        check([expected count] == PATCH_LIST_COUNT, @"mapper decode returns the patch list");
+        check([serializerDecodedMessage(serializer, listData) isEqual:expected], @"serializer decode returns the same patch list");
+
+        NSDictionary *patch = @{ @"guid" : @"abc", @"name" : @"Ünïcödé 🎹" };
+        NSString *patchMessage = [[NSString alloc] initWithData:[NSJSONSerialization dataWithJSONObject:patch options:0 error:nil]
+                                                       encoding:NSUTF8StringEncoding];
+        check([serializerDecodedMessage(serializer, envelope(patchMessage)) isEqual:patch], @"non-ASCII object message decodes");
+        check([serializerDecodedMessage(serializer, envelope(@"  [1, 2]")) isEqual:(@[ @1, @2 ])], @"message with leading whitespace decodes");
+        check([serializerDecodedMessage(serializer, envelope(@"Patch not found")) isEqual:@"Patch not found"], @"plain text message stays a string");
+        check([serializerDecodedMessage(serializer, envelope(@"{ not json")) isEqual:@"{ not json"], @"malformed JSON message stays a string");
+        check([serializerDecodedMessage(serializer, envelope(@"")) isEqual:@""], @"empty message stays a string");
+        check([serializerDecodedMessage(serializer, envelope(@{ @"already" : @"decoded" })) isEqual:@{ @"already" : @"decoded" }],
+              @"object message is left as is");
+
+        double mapperTime = millisecondsPerRun(DECODE_ITERATIONS, ^{
+            mapperDecodedMessage(jsonSerializer, listData);
+        });
+        double serializerTime = millisecondsPerRun(DECODE_ITERATIONS, ^{
+            serializerDecodedMessage(serializer, listData);
+        });
+        NSLog(@"%lu patches, %lu byte envelope - AFJSONResponseSerializer then mapper %.1f ms, ChuckPadResponseSerializer %.1f ms",
+              (unsigned long)PATCH_LIST_COUNT, (unsigned long)[listData length], mapperTime, serializerTime);
+    }
+    return checkResult();
+}
+
+#endif
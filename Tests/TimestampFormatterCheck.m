@@ -0,0 +1,135 @@
+//
+//  TimestampFormatterCheck.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Checks that TimestampFormatter reads and writes timestamps exactly like an en_US_POSIX, Gregorian NSDateFormatter
+//  in several default time zones, including around daylight saving time changes, and times parsing 100k timestamps
+//  with each. Build and run from the repository root:
+//
+//      clang -fobjc-arc -DCHUCKPAD_SOCIAL_CHECKS -framework Foundation -I. \
+//          Tests/TimestampFormatterCheck.m TimestampFormatter.m -o timestamp-formatter-check && ./timestamp-formatter-check
+
+#ifdef CHUCKPAD_SOCIAL_CHECKS
+
+#import <Foundation/Foundation.h>
+
+#import "Check.h"
+#import "TimestampFormatter.h"
+
+static const NSUInteger RANDOM_TIMESTAMP_COUNT = 20000;
+static const NSUInteger BENCHMARK_TIMESTAMP_COUNT = 100000;
+
+// 1970-01-01 to 2037-12-31
+static const uint32_t RANDOM_TIMESTAMP_RANGE = 2145830400;
+
+static NSDateFormatter *referenceFormatter(void) {
+    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+    [formatter setLocale:[NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"]];
+    [formatter setCalendar:[[NSCalendar alloc] initWithCalendarIdentifier:NSCalendarIdentifierGregorian]];
+    [formatter setTimeZone:[NSTimeZone defaultTimeZone]];
+    [formatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
+    return formatter;
+}
+
+// Timestamps spread over the whole range plus every hour of the days around each daylight saving time change
+static NSArray *timestamps(NSDateFormatter *formatter) {
+    NSMutableArray *timestamps = [[NSMutableArray alloc] init];
+    srandom(17);
+    for (NSUInteger i = 0; i < RANDOM_TIMESTAMP_COUNT; i++) {
+        [timestamps addObject:[formatter stringFromDate:[NSDate dateWithTimeIntervalSince1970:random() % RANDOM_TIMESTAMP_RANGE]]];
+    }
+
+    NSTimeZone *timeZone = [formatter timeZone];
+    NSDate *transition = [timeZone nextDaylightSavingTimeTransitionAfterDate:[NSDate dateWithTimeIntervalSince1970:0]];
+    while (transition != nil && [transition timeIntervalSince1970] < RANDOM_TIMESTAMP_RANGE) {
+        for (NSInteger minutes = -26 * 60; minutes <= 26 * 60; minutes += 30) {
+            [timestamps addObject:[formatter stringFromDate:[transition dateByAddingTimeInterval:minutes * 60]]];
+        }
+        transition = [timeZone nextDaylightSavingTimeTransitionAfterDate:transition];
+    }
+    return timestamps;
+}
+
+static void checkTimeZone(NSString *timeZoneName) {
+    [NSTimeZone setDefaultTimeZone:[NSTimeZone timeZoneWithName:timeZoneName]];
+    NSDateFormatter *formatter = referenceFormatter();
+    NSArray *strings = timestamps(formatter);
+
+    NSUInteger parseMismatchCount = 0;
+    NSUInteger formatMismatchCount = 0;
+    for (NSString *string in strings) {
+        NSDate *expected = [formatter dateFromString:string];
+        NSDate *actual = [TimestampFormatter dateFromString:string];
+        if (!(expected == nil ? actual == nil : [actual isEqualToDate:expected])) {
+            parseMismatchCount++;
+            NSLog(@"%@ - %@ parsed as %@ instead of %@", timeZoneName, string, actual, expected);
+        }
+        if (expected != nil && ![[TimestampFormatter stringFromDate:expected] isEqualToString:[formatter stringFromDate:expected]]) {
+            formatMismatchCount++;
+            NSLog(@"%@ - %@ formatted as %@", timeZoneName, expected, [TimestampFormatter stringFromDate:expected]);
+        }
+    }
+    check(parseMismatchCount == 0, [NSString stringWithFormat:@"%@ - %lu timestamps parse like NSDateFormatter",
+                                    timeZoneName, (unsigned long)[strings count]]);
+    check(formatMismatchCount == 0, [NSString stringWithFormat:@"%@ - dates format like NSDateFormatter", timeZoneName]);
+
+    NSString *leapDay = @"2016-02-29 23:59:59";
+    check([[TimestampFormatter stringFromDate:[TimestampFormatter dateFromString:leapDay]] isEqualToString:leapDay],
+          [NSString stringWithFormat:@"%@ - leap day round trips", timeZoneName]);
+}
+
+static void checkInvalidTimestamps(void) {
+    NSDateFormatter *formatter = referenceFormatter();
+    for (NSString *string in @[ @"", @"not a timestamp", @"2016-06-17", @"2016-06-17T12:34:56", @"2016-13-01 00:00:00",
+                                @"2016-06-17 24:00:00", @"2016-06-17 12:60:00", @"0000-01-01 00:00:00", @"２０１６-06-17 12:34:56" ]) {
+        NSDate *expected = [formatter dateFromString:string];
+        NSDate *actual = [TimestampFormatter dateFromString:string];
+        check(expected == nil ? actual == nil : [actual isEqualToDate:expected],
+              [NSString stringWithFormat:@"\"%@\" parses like NSDateFormatter (%@)", string, actual]);
+    }
+    check([TimestampFormatter dateFromString:nil] == nil, @"nil parses to nil");
+    check([TimestampFormatter dateFromString:(NSString *)[NSNull null]] == nil, @"NSNull parses to nil");
+    check([TimestampFormatter stringFromDate:nil] == nil, @"nil formats to nil");
+}
+
+static void benchmark(void) {
+    [NSTimeZone setDefaultTimeZone:[NSTimeZone timeZoneWithName:@"America/Los_Angeles"]];
+
+    // Like the formatter Patch and LiveSession used before TimestampFormatter
+    NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
+    [formatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
+
+    NSMutableArray *strings = [[NSMutableArray alloc] initWithCapacity:BENCHMARK_TIMESTAMP_COUNT];
+    srandom(42);
+    for (NSUInteger i = 0; i < BENCHMARK_TIMESTAMP_COUNT; i++) {
+        [strings addObject:[formatter stringFromDate:[NSDate dateWithTimeIntervalSince1970:1400000000 + random() % 300000000]]];
+    }
+
+    double formatterTime = millisecondsPerRun(1, ^{
+        for (NSString *string in strings) {
+            [formatter dateFromString:string];
+        }
+    });
+    double timestampFormatterTime = millisecondsPerRun(1, ^{
+        for (NSString *string in strings) {
+            [TimestampFormatter dateFromString:string];
+        }
+    });
+    NSLog(@"%lu timestamps - NSDateFormatter %.1f ms, TimestampFormatter %.1f ms", (unsigned long)BENCHMARK_TIMESTAMP_COUNT,
+          formatterTime, timestampFormatterTime);
+}
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+        for (NSString *timeZoneName in @[ @"UTC", @"America/Los_Angeles", @"Europe/Berlin", @"Australia/Lord_Howe",
+                                          @"Asia/Kolkata", @"Pacific/Apia", @"America/Sao_Paulo" ]) {
+            checkTimeZone(timeZoneName);
+        }
+        checkInvalidTimestamps();
+        benchmark();
+    }
+    return checkResult();
+}
+
+#endif
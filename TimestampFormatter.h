@@ -0,0 +1,23 @@
+//
+//  TimestampFormatter.h
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+//  Converts the service's "yyyy-MM-dd HH:mm:ss" timestamps to and from NSDate. The fields are read in the default time
+//  zone, always with the Gregorian calendar and Western digits. This differs from the plain NSDateFormatter used
+//  before, which followed the user's locale and calendar: on a device set to e.g. the Buddhist or Japanese calendar
+//  it read the year in that calendar and produced dates centuries off. The fixed format is parsed by hand, which is
+//  many times faster, and it is safe to call from any thread. Anything not in exactly that format is handed to an
+//  en_US_POSIX, Gregorian NSDateFormatter owned by the calling thread.
+
+#import <Foundation/Foundation.h>
+
+@interface TimestampFormatter : NSObject
+
+// Returns nil if string is nil or not a valid timestamp.
++ (NSDate *)dateFromString:(NSString *)string;
+
+// Returns nil if date is nil.
++ (NSString *)stringFromDate:(NSDate *)date;
+
+@end
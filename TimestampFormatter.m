@@ -0,0 +1,156 @@
+//
+//  TimestampFormatter.m
+//  chuckpad-social-ios
+//  https://github.com/markcerqueira/chuckpad-social-ios
+//
+
+#import "TimestampFormatter.h"
+
+static NSString *const TIMESTAMP_FORMAT = @"yyyy-MM-dd HH:mm:ss";
+static NSString *const TIMESTAMP_FORMATTER_THREAD_KEY = @"chuckpad-social.timestamp-formatter";
+
+// Length of "yyyy-MM-dd HH:mm:ss"
+static const NSUInteger TIMESTAMP_LENGTH = 19;
+
+static const int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+
+// Days since 1970-01-01 of the given proleptic Gregorian date
+// http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+static int64_t daysFromCivil(int64_t year, int64_t month, int64_t day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// Inverse of daysFromCivil
+// http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+static void civilFromDays(int64_t days, int64_t *year, int64_t *month, int64_t *day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthPart = (5 * dayOfYear + 2) / 153;
+    *day = dayOfYear - (153 * monthPart + 2) / 5 + 1;
+    *month = monthPart + (monthPart < 10 ? 3 : -9);
+    *year = yearOfEra + era * 400 + (*month <= 2);
+}
+
+static int64_t daysInMonth(int64_t year, int64_t month) {
+    static const int64_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    BOOL isLeapYear = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && isLeapYear ? 29 : days[month - 1];
+}
+
+// Reads count digits starting at characters[start]. Returns -1 if any of them is not a digit.
+static int64_t readDigits(const char *characters, NSUInteger start, NSUInteger count) {
+    int64_t value = 0;
+    for (NSUInteger i = start; i < start + count; i++) {
+        if (characters[i] < '0' || characters[i] > '9') {
+            return -1;
+        }
+        value = value * 10 + (characters[i] - '0');
+    }
+    return value;
+}
+
+@implementation TimestampFormatter
+
++ (NSDate *)dateFromString:(NSString *)string {
+    if (![string isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+
+    NSDate *date = [self fastDateFromString:string];
+    if (date != nil) {
+        return date;
+    }
+
+    return [[self threadFormatter] dateFromString:string];
+}
+
++ (NSString *)stringFromDate:(NSDate *)date {
+    if (date == nil) {
+        return nil;
+    }
+
+    int64_t seconds = (int64_t)floor([date timeIntervalSince1970]) + [[NSTimeZone defaultTimeZone] secondsFromGMTForDate:date];
+    int64_t days = seconds >= 0 ? seconds / SECONDS_PER_DAY : (seconds - SECONDS_PER_DAY + 1) / SECONDS_PER_DAY;
+    int64_t secondOfDay = seconds - days * SECONDS_PER_DAY;
+
+    int64_t year, month, day;
+    civilFromDays(days, &year, &month, &day);
+
+    // Years outside of 4 digits are rare enough to leave to NSDateFormatter
+    if (year < 0 || year > 9999) {
+        return [[self threadFormatter] stringFromDate:date];
+    }
+
+    char characters[TIMESTAMP_LENGTH + 1];
+    snprintf(characters, sizeof(characters), "%04lld-%02lld-%02lld %02lld:%02lld:%02lld", year, month, day,
+             secondOfDay / 3600, (secondOfDay / 60) % 60, secondOfDay % 60);
+    return [[NSString alloc] initWithBytes:characters length:TIMESTAMP_LENGTH encoding:NSASCIIStringEncoding];
+}
+
+// Returns nil for anything that is not exactly "yyyy-MM-dd HH:mm:ss" with valid values, or that is close to a daylight
+// saving time change, so NSDateFormatter gets to decide what those mean.
++ (NSDate *)fastDateFromString:(NSString *)string {
+    char characters[TIMESTAMP_LENGTH + 1];
+    if ([string length] != TIMESTAMP_LENGTH || ![string getCString:characters maxLength:sizeof(characters) encoding:NSASCIIStringEncoding]) {
+        return nil;
+    }
+
+    if (characters[4] != '-' || characters[7] != '-' || characters[10] != ' ' || characters[13] != ':' || characters[16] != ':') {
+        return nil;
+    }
+
+    int64_t year = readDigits(characters, 0, 4);
+    int64_t month = readDigits(characters, 5, 2);
+    int64_t day = readDigits(characters, 8, 2);
+    int64_t hour = readDigits(characters, 11, 2);
+    int64_t minute = readDigits(characters, 14, 2);
+    int64_t second = readDigits(characters, 17, 2);
+
+    if (year < 1 || month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month) ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 59) {
+        return nil;
+    }
+
+    int64_t localSeconds = daysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+
+    // The fields are local time. Within a day of a daylight saving time change a local time can be skipped or happen
+    // twice, so those are left to NSDateFormatter; otherwise the offset is the same all around the timestamp.
+    NSTimeZone *timeZone = [NSTimeZone defaultTimeZone];
+    NSInteger offsetBefore = [timeZone secondsFromGMTForDate:[NSDate dateWithTimeIntervalSince1970:localSeconds - SECONDS_PER_DAY]];
+    NSInteger offsetAfter = [timeZone secondsFromGMTForDate:[NSDate dateWithTimeIntervalSince1970:localSeconds + SECONDS_PER_DAY]];
+    if (offsetBefore != offsetAfter) {
+        return nil;
+    }
+
+    return [NSDate dateWithTimeIntervalSince1970:localSeconds - offsetBefore];
+}
+
+// NSDateFormatter is not safe to share between threads so each thread that needs one gets its own. It is pinned to the
+// POSIX locale and the Gregorian calendar so it reads timestamps the same way as fastDateFromString. A formatter keeps
+// the time zone that was the default when it was created, so it is moved along if the default changes afterwards.
++ (NSDateFormatter *)threadFormatter {
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSDateFormatter *formatter = threadDictionary[TIMESTAMP_FORMATTER_THREAD_KEY];
+    if (formatter == nil) {
+        formatter = [[NSDateFormatter alloc] init];
+        [formatter setLocale:[NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"]];
+        [formatter setCalendar:[[NSCalendar alloc] initWithCalendarIdentifier:NSCalendarIdentifierGregorian]];
+        [formatter setDateFormat:TIMESTAMP_FORMAT];
+        threadDictionary[TIMESTAMP_FORMATTER_THREAD_KEY] = formatter;
+    }
+    NSTimeZone *timeZone = [NSTimeZone defaultTimeZone];
+    if (![[formatter timeZone] isEqualToTimeZone:timeZone]) {
+        [formatter setTimeZone:timeZone];
+    }
+    return formatter;
+}
+
+@end